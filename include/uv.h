@@ -246,9 +246,19 @@ typedef struct uv_dirent_s uv_dirent_t;
 typedef struct uv_passwd_s uv_passwd_t;
 typedef struct uv_utsname_s uv_utsname_t;
 typedef struct uv_statfs_s uv_statfs_t;
+typedef struct uv_metrics_s uv_metrics_t;
+typedef struct uv_threadpool_s uv_threadpool_t;
+typedef struct uv_threadpool_metrics_s uv_threadpool_metrics_t;
 
 enum uv_loop_option : ssize_t {
-  UV_LOOP_BLOCK_SIGNAL
+  UV_LOOP_BLOCK_SIGNAL,
+  UV_LOOP_USE_IO_URING,
+  UV_LOOP_BUSY_POLL,
+  UV_LOOP_SOCKET_BUSY_POLL,
+  UV_LOOP_ENABLE_METRICS,
+  UV_LOOP_TIMER_WHEEL,
+  UV_LOOP_THREADPOOL,
+  UV_LOOP_WORK_PRIORITY
 };
 
 enum uv_run_mode : ssize_t {
@@ -257,6 +267,26 @@ enum uv_run_mode : ssize_t {
   UV_RUN_NOWAIT
 };
 
+enum uv_metrics_phase : ssize_t {
+  UV_METRICS_PHASE_TIMERS,
+  UV_METRICS_PHASE_PENDING,
+  UV_METRICS_PHASE_IDLE,
+  UV_METRICS_PHASE_PREPARE,
+  UV_METRICS_PHASE_POLL,
+  UV_METRICS_PHASE_CHECK,
+  UV_METRICS_PHASE_CLOSING,
+  UV_METRICS_PHASE_MAX
+};
+
+struct uv_metrics_s {
+  uint64_t loop_count;
+  uint64_t events;
+  uint64_t event_waits;
+  uint64_t idle_time;
+  uint64_t busy_poll_time;
+  uint64_t phase_time[UV_METRICS_PHASE_MAX];
+};
+
 
 UV_EXTERN unsigned int uv_version(void);
 UV_EXTERN const char* uv_version_string(void);
@@ -303,6 +333,9 @@ UV_EXTERN uint64_t uv_now(const uv_loop_t*);
 
 UV_EXTERN int uv_backend_fd(const uv_loop_t*);
 UV_EXTERN int uv_backend_timeout(const uv_loop_t*);
+UV_EXTERN uint64_t uv_metrics_busy_poll_time(const uv_loop_t* loop);
+UV_EXTERN uint64_t uv_metrics_idle_time(const uv_loop_t* loop);
+UV_EXTERN int uv_metrics_info(const uv_loop_t* loop, uv_metrics_t* metrics);
 
 typedef void (*uv_alloc_cb)(uv_handle_t* handle,
                             size_t suggested_size,
@@ -310,6 +343,14 @@ typedef void (*uv_alloc_cb)(uv_handle_t* handle,
 typedef void (*uv_read_cb)(uv_stream_t* stream,
                            ssize_t nread,
                            const uv_buf_t* buf);
+typedef void (*uv_alloc_bufs_cb)(uv_handle_t* handle,
+                                 size_t suggested_size,
+                                 uv_buf_t bufs[],
+                                 unsigned int* nbufs);
+typedef void (*uv_read_bufs_cb)(uv_stream_t* stream,
+                                ssize_t nread,
+                                const uv_buf_t bufs[],
+                                unsigned int nbufs);
 typedef void (*uv_write_cb)(uv_write_t* req, int status);
 typedef void (*uv_connect_cb)(uv_connect_t* req, int status);
 typedef void (*uv_shutdown_cb)(uv_shutdown_t* req, int status);
@@ -326,6 +367,9 @@ typedef void (*uv_walk_cb)(uv_handle_t* handle, void* arg);
 typedef void (*uv_fs_cb)(uv_fs_t* req);
 typedef void (*uv_work_cb)(uv_work_t* req);
 typedef void (*uv_after_work_cb)(uv_work_t* req, int status);
+typedef void (*uv_after_work_batch_cb)(uv_work_t* reqs, unsigned int nreqs);
+typedef int (*uv_work_chunk_cb)(uv_work_t* req);
+typedef void (*uv_work_progress_cb)(uv_work_t* req);
 typedef void (*uv_getaddrinfo_cb)(uv_getaddrinfo_t* req,
                                   int status,
                                   addrinfo* res);
@@ -503,6 +547,12 @@ UV_EXTERN int uv_accept(uv_stream_t* server, uv_stream_t* client);
 UV_EXTERN int uv_read_start(uv_stream_t*,
                             uv_alloc_cb alloc_cb,
                             uv_read_cb read_cb);
+UV_EXTERN int uv_read_start_bufs(uv_stream_t*,
+                                 uv_alloc_bufs_cb alloc_cb,
+                                 uv_read_bufs_cb read_cb);
+UV_EXTERN int uv_read_start_pooled(uv_stream_t*, uv_read_cb read_cb);
+UV_EXTERN void uv_read_buf_retain(uv_loop_t* loop, const uv_buf_t* buf);
+UV_EXTERN void uv_read_buf_release(uv_loop_t* loop, const uv_buf_t* buf);
 UV_EXTERN int uv_read_stop(uv_stream_t*);
 
 UV_EXTERN int uv_write(uv_write_t* req,
@@ -534,6 +584,10 @@ UV_EXTERN int uv_is_readable(const uv_stream_t* handle);
 UV_EXTERN int uv_is_writable(const uv_stream_t* handle);
 
 UV_EXTERN int uv_stream_set_blocking(uv_stream_t* handle, int blocking);
+UV_EXTERN int uv_stream_set_edge_triggered(uv_stream_t* handle, int enable);
+UV_EXTERN int uv_stream_set_cork(uv_stream_t* handle,
+                                 int enable,
+                                 size_t threshold);
 
 UV_EXTERN int uv_is_closing(const uv_handle_t* handle);
 
@@ -556,6 +610,7 @@ UV_EXTERN int uv_tcp_nodelay(uv_tcp_t* handle, int enable);
 UV_EXTERN int uv_tcp_keepalive(uv_tcp_t* handle,
                                int enable,
                                unsigned int delay);
+UV_EXTERN int uv_tcp_zerocopy(uv_tcp_t* handle, int enable, size_t threshold);
 UV_EXTERN int uv_tcp_simultaneous_accepts(uv_tcp_t* handle, int enable);
 
 enum uv_tcp_flags : ssize_t {
@@ -854,10 +909,16 @@ UV_EXTERN int uv_timer_start(uv_timer_t* handle,
                              uv_timer_cb cb,
                              uint64_t timeout,
                              uint64_t repeat);
+UV_EXTERN int uv_timer_start_ns(uv_timer_t* handle,
+                                uv_timer_cb cb,
+                                uint64_t timeout,
+                                uint64_t repeat);
 UV_EXTERN int uv_timer_stop(uv_timer_t* handle);
 UV_EXTERN int uv_timer_again(uv_timer_t* handle);
 UV_EXTERN void uv_timer_set_repeat(uv_timer_t* handle, uint64_t repeat);
 UV_EXTERN uint64_t uv_timer_get_repeat(const uv_timer_t* handle);
+UV_EXTERN void uv_timer_set_slack(uv_timer_t* handle, uint64_t slack);
+UV_EXTERN uint64_t uv_timer_get_slack(const uv_timer_t* handle);
 
 
 /*
@@ -1059,10 +1120,77 @@ struct uv_work_s {
   UV_WORK_PRIVATE_FIELDS
 };
 
+enum uv_work_priority : ssize_t {
+  UV_WORK_PRIORITY_NORMAL = 0,
+  UV_WORK_PRIORITY_HIGH,
+  UV_WORK_PRIORITY_LOW
+};
+
 UV_EXTERN int uv_queue_work(uv_loop_t* loop,
                             uv_work_t* req,
                             uv_work_cb work_cb,
                             uv_after_work_cb after_work_cb);
+UV_EXTERN int uv_queue_work_batch(uv_loop_t* loop,
+                                  uv_work_t reqs[],
+                                  unsigned int nreqs,
+                                  uv_work_cb work_cb,
+                                  uv_after_work_cb after_work_cb,
+                                  uv_after_work_batch_cb after_batch_cb);
+UV_EXTERN int uv_queue_work_chunked(uv_loop_t* loop,
+                                    uv_work_t* req,
+                                    uv_work_chunk_cb chunk_cb,
+                                    uv_work_progress_cb progress_cb,
+                                    uv_after_work_cb after_work_cb);
+
+struct uv_threadpool_s {
+  /* public */
+  void* data;
+  /* private */
+  void* internal_fields;
+};
+
+UV_EXTERN uv_threadpool_t* uv_default_threadpool(void);
+UV_EXTERN int uv_threadpool_init(uv_threadpool_t* pool,
+                                 unsigned int min_threads,
+                                 unsigned int max_threads);
+UV_EXTERN int uv_threadpool_close(uv_threadpool_t* pool);
+UV_EXTERN int uv_threadpool_set_size(uv_threadpool_t* pool,
+                                     unsigned int min_threads,
+                                     unsigned int max_threads);
+
+enum uv_threadpool_affinity_flags : ssize_t {
+  UV_THREADPOOL_PER_NUMA_NODE = 0x01
+};
+
+UV_EXTERN int uv_threadpool_set_affinity(uv_threadpool_t* pool,
+                                         const char* cpumask,
+                                         size_t mask_size,
+                                         unsigned int flags);
+
+#define UV_THREADPOOL_HISTOGRAM_SIZE 32
+
+enum uv_threadpool_work_kind : ssize_t {
+  UV_THREADPOOL_WORK_CPU,
+  UV_THREADPOOL_WORK_FAST_IO,
+  UV_THREADPOOL_WORK_SLOW_IO,
+  UV_THREADPOOL_WORK_KIND_MAX
+};
+
+struct uv_threadpool_metrics_s {
+  unsigned int threads;
+  unsigned int idle_threads;
+  unsigned int queued;
+  unsigned int slow_io_work_running;
+  uint64_t cancelled;
+  uint64_t cancel_races;
+  uint64_t wait_time[UV_THREADPOOL_WORK_KIND_MAX]
+                    [UV_THREADPOOL_HISTOGRAM_SIZE];
+  uint64_t run_time[UV_THREADPOOL_WORK_KIND_MAX]
+                   [UV_THREADPOOL_HISTOGRAM_SIZE];
+};
+
+UV_EXTERN int uv_threadpool_metrics_info(uv_threadpool_t* pool,
+                                         uv_threadpool_metrics_t* metrics);
 
 UV_EXTERN int uv_cancel(uv_req_t* req);
 
@@ -1727,12 +1855,15 @@ UV_EXTERN int uv_thread_create(uv_thread_t* tid, uv_thread_cb entry, void* arg);
 
 enum uv_thread_create_flags : ssize_t {
   UV_THREAD_NO_FLAGS = 0x00,
-  UV_THREAD_HAS_STACK_SIZE = 0x01
+  UV_THREAD_HAS_STACK_SIZE = 0x01,
+  UV_THREAD_HAS_AFFINITY = 0x02
 };
 
 struct uv_thread_options_s {
   unsigned int flags;
   size_t stack_size;
+  const char* cpumask;
+  size_t mask_size;
   /* More fields may be added at any time. */
 };
 
@@ -1742,6 +1873,12 @@ UV_EXTERN int uv_thread_create_ex(uv_thread_t* tid,
                                   const uv_thread_options_t* params,
                                   uv_thread_cb entry,
                                   void* arg);
+UV_EXTERN int uv_thread_setaffinity(uv_thread_t* tid,
+                                    const char* cpumask,
+                                    char* oldmask,
+                                    size_t mask_size);
+UV_EXTERN int uv_thread_getcpu(void);
+UV_EXTERN int uv_cpumask_size(void);
 UV_EXTERN uv_thread_t uv_thread_self(void);
 UV_EXTERN int uv_thread_join(uv_thread_t *tid);
 UV_EXTERN int uv_thread_equal(const uv_thread_t* t1, const uv_thread_t* t2);
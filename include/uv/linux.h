@@ -26,6 +26,12 @@
   uv__io_t inotify_read_watcher;                                              \
   void* inotify_watchers;                                                     \
   int inotify_fd;                                                             \
+  void* iou_ring;                                                             \
+  unsigned int busy_poll;                                                     \
+  unsigned int socket_busy_poll;                                              \
+  uint64_t busy_poll_time;                                                    \
+  uv__io_t hrtimer_watcher;                                                   \
+  uint64_t hrtimer_due;                                                       \
 
 #define UV_PLATFORM_FS_EVENT_FIELDS                                           \
   void* watchers[2];                                                          \
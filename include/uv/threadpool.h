@@ -33,6 +33,11 @@ struct uv__work {
   void (*done)(uv__work *w, int status);
   uv_loop_s* loop;
   void* wq[2];
+  void* owner;
+  unsigned int kind;
+  uint64_t submit_time;
+  int requeue;
+  int state;
 };
 
 #endif /* UV_THREADPOOL_H_ */
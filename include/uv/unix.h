@@ -226,8 +226,7 @@ struct uv_lib_t {
   uv__io_t** watchers;                                                        \
   unsigned int nwatchers;                                                     \
   unsigned int nfds;                                                          \
-  void* wq[2];                                                                \
-  uv_mutex_t wq_mutex;                                                        \
+  void* wq;                                                                   \
   uv_async_t wq_async;                                                        \
   uv_rwlock_t cloexec_lock;                                                   \
   uv_handle_t* closing_handles;                                               \
@@ -239,17 +238,27 @@ struct uv_lib_t {
   void (*async_unused)(void);  /* TODO(bnoordhuis) Remove in libuv v2. */     \
   uv__io_t async_io_watcher;                                                  \
   int async_wfd;                                                              \
+  void* async_pending;                                                        \
+  void* async_ready[2];                                                       \
   struct _timer_heap {                                                         \
-    void* min;                                                                \
+    void* nodes;                                                              \
     unsigned int nelts;                                                       \
+    unsigned int size;                                                        \
   };                                                                          \
   _timer_heap timer_heap;                                                      \
   uint64_t timer_counter;                                                     \
+  void* timer_wheel;                                                          \
+  void* threadpool;                                                           \
+  int work_priority;                                                          \
+  void* read_pool;                                                            \
+  _timer_heap hrtimer_heap;                                                   \
   uint64_t time;                                                              \
   int signal_pipefd[2];                                                       \
   uv__io_t signal_io_watcher;                                                 \
   uv_signal_t child_watcher;                                                  \
   int emfile_fd;                                                              \
+  uv_metrics_t metrics;                                                       \
+  uint64_t metrics_time;                                                      \
   UV_PLATFORM_LOOP_FIELDS                                                     \
 
 #define UV_REQ_TYPE_PRIVATE /* empty */
@@ -264,6 +273,10 @@ struct uv_lib_t {
   uv_buf_t* bufs;                                                             \
   unsigned int nbufs;                                                         \
   int error;                                                                  \
+  int zerocopy;                                                               \
+  unsigned int zerocopy_first;                                                \
+  unsigned int zerocopy_sent;                                                 \
+  unsigned int zerocopy_done;                                                 \
   uv_buf_t bufsml[4];                                                         \
 
 #define UV_CONNECT_PRIVATE_FIELDS                                             \
@@ -294,6 +307,13 @@ struct uv_lib_t {
   int delayed_error;                                                          \
   int accepted_fd;                                                            \
   void* queued_fds;                                                           \
+  uv_alloc_bufs_cb alloc_bufs_cb;                                             \
+  uv_read_bufs_cb read_bufs_cb;                                               \
+  void* write_zerocopy_queue[2];                                              \
+  size_t zerocopy_threshold;                                                  \
+  unsigned int zerocopy_next;                                                 \
+  unsigned int zerocopy_inflight;                                             \
+  size_t cork_threshold;                                                      \
   UV_STREAM_PRIVATE_PLATFORM_FIELDS                                           \
 
 #define UV_TCP_PRIVATE_FIELDS /* empty */
@@ -327,13 +347,16 @@ struct uv_lib_t {
   uv_async_cb async_cb;                                                       \
   void* queue[2];                                                             \
   int pending;                                                                \
+  void* pending_next;                                                         \
+  void* pending_queue[2];                                                     \
 
 #define UV_TIMER_PRIVATE_FIELDS                                               \
   uv_timer_cb timer_cb;                                                       \
   void* heap_node[3];                                                         \
   uint64_t timeout;                                                           \
   uint64_t repeat;                                                            \
-  uint64_t start_id;
+  uint64_t start_id;                                                          \
+  uint64_t slack;
 
 #define UV_GETADDRINFO_PRIVATE_FIELDS                                         \
   uv__work work_req;                                                          \
@@ -373,7 +396,17 @@ struct uv_lib_t {
   uv_buf_t bufsml[4];                                                         \
 
 #define UV_WORK_PRIVATE_FIELDS                                                \
-  uv__work work_req;
+  uv__work work_req;                                                          \
+  /* First request of the batch, and on that one the batch bookkeeping. */    \
+  uv_work_t* batch;                                                           \
+  unsigned int batch_size;                                                    \
+  unsigned int batch_pending;                                                 \
+  uv_after_work_batch_cb after_batch_cb;                                      \
+  /* Chunked work, `progress_req` carries the progress notifications. */      \
+  uv_work_chunk_cb chunk_cb;                                                  \
+  uv_work_progress_cb progress_cb;                                            \
+  uv__work progress_req;                                                      \
+  int progress_pending;
 
 #define UV_TTY_PRIVATE_FIELDS                                                 \
   termios orig_termios;                                                       \
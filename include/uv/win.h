@@ -348,6 +348,14 @@ struct uv_lib_t {
   uv_handle_t* endgame_handles;                                               \
   /* TODO(bnoordhuis) Stop heap-allocating |timer_heap| in libuv v2.x. */     \
   void* timer_heap;                                                           \
+  void* timer_wheel;                                                          \
+  void* threadpool;                                                           \
+  int work_priority;                                                          \
+  struct {                                                                    \
+    void* nodes;                                                              \
+    unsigned int nelts;                                                       \
+    unsigned int size;                                                        \
+  } hrtimer_heap;                                                             \
     /* Lists of active loop (prepare / check / idle) watchers */              \
   uv_prepare_t* prepare_handles;                                              \
   uv_check_t* check_handles;                                                  \
@@ -368,8 +376,7 @@ struct uv_lib_t {
   /* Counter to started timer */                                              \
   uint64_t timer_counter;                                                     \
   /* Threadpool */                                                            \
-  void* wq[2];                                                                \
-  uv_mutex_t wq_mutex;                                                        \
+  void* wq;                                                                   \
   uv_async_t wq_async;
 
 #define UV_REQ_TYPE_PRIVATE                                                   \
@@ -573,6 +580,7 @@ struct uv_lib_t {
   uint64_t timeout;                                                           \
   uint64_t repeat;                                                            \
   uint64_t start_id;                                                          \
+  uint64_t slack;                                                             \
   uv_timer_cb timer_cb;
 
 #define UV_ASYNC_PRIVATE_FIELDS                                               \
@@ -665,7 +673,17 @@ struct uv_lib_t {
   _fs fs;
 
 #define UV_WORK_PRIVATE_FIELDS                                                \
-  uv__work work_req;
+  uv__work work_req;                                                          \
+  /* First request of the batch, and on that one the batch bookkeeping. */    \
+  uv_work_t* batch;                                                           \
+  unsigned int batch_size;                                                    \
+  unsigned int batch_pending;                                                 \
+  uv_after_work_batch_cb after_batch_cb;                                      \
+  /* Chunked work, `progress_req` carries the progress notifications. */      \
+  uv_work_chunk_cb chunk_cb;                                                  \
+  uv_work_progress_cb progress_cb;                                            \
+  uv__work progress_req;                                                      \
+  int progress_pending;
 
 #define UV_FS_EVENT_PRIVATE_FIELDS                                            \
   struct uv_fs_event_req_s {                                                  \
@@ -16,7 +16,12 @@
 #ifndef UV_SRC_HEAP_H_
 #define UV_SRC_HEAP_H_
 
+#include "uv.h"
+#include "uv-common.h"
+
+#include <assert.h>
 #include <stddef.h>  /* nullptr */
+#include <stdint.h>  /* uintptr_t */
 
 #if defined(__GNUC__)
 # define HEAP_EXPORT __attribute__((unused)) static
@@ -24,220 +29,174 @@
 # define HEAP_EXPORT static
 #endif
 
+/* Children of node i are at HEAP_ARITY * i + 1 .. HEAP_ARITY * i + HEAP_ARITY,
+ * four of them fit in a cache line together with their keys.
+ */
+#define HEAP_ARITY 4
+#define HEAP_MIN_SIZE 64
+
+/* The sort key is stored inline so that comparisons don't have to touch the
+ * timers themselves.  The timer's position in the array is kept in
+ * uv_timer_t.heap_node[0], that's what makes removal O(log n).
+ */
 struct heap_node {
-  heap_node* left;
-  heap_node* right;
-  heap_node* parent;
+  uint64_t timeout;
+  uint64_t start_id;
+  uv_timer_t* handle;
 };
 
-/* A binary min heap.  The usual properties hold: the root is the lowest
- * element in the set, the height of the tree is at most log2(nodes) and
- * it's always a complete binary tree.
- *
- * The heap function try hard to detect corrupted tree nodes at the cost
- * of a minor reduction in performance.  Compile with -DNDEBUG to disable.
+/* A 4-ary min heap of timers in a contiguous array, ordered by timeout and
+ * then by start_id.  The array grows by doubling and is never shrunk, so
+ * removing a timer and inserting it again can't fail.
  */
 struct heap {
-  heap_node* min;
+  heap_node* nodes;
   unsigned int nelts;
+  unsigned int size;
 };
 
-/* Return non-zero if a < b. */
-typedef int (*heap_compare_fn)(const heap_node* a,
-                               const heap_node* b);
-
 /* Public functions. */
 HEAP_EXPORT void heap_init(heap* heap);
-HEAP_EXPORT heap_node* heap_min(const heap* heap);
-HEAP_EXPORT void heap_insert(heap* heap,
-                             heap_node* newnode,
-                             heap_compare_fn less_than);
-HEAP_EXPORT void heap_remove(heap* heap,
-                             heap_node* node,
-                             heap_compare_fn less_than);
-HEAP_EXPORT void heap_dequeue(heap* heap, heap_compare_fn less_than);
+HEAP_EXPORT void heap_free(heap* heap);
+HEAP_EXPORT const heap_node* heap_min(const heap* heap);
+HEAP_EXPORT int heap_insert(heap* heap, uv_timer_t* handle);
+HEAP_EXPORT void heap_remove(heap* heap, uv_timer_t* handle);
 
 /* Implementation follows. */
 
 HEAP_EXPORT void heap_init(heap* heap) {
-  heap->min = nullptr;
+  heap->nodes = nullptr;
   heap->nelts = 0;
+  heap->size = 0;
 }
 
-HEAP_EXPORT heap_node* heap_min(const heap* heap) {
-  return heap->min;
+HEAP_EXPORT void heap_free(heap* heap) {
+  assert(heap->nelts == 0);
+  uv__free(heap->nodes);
+  heap_init(heap);
 }
 
-/* Swap parent with child. Child moves closer to the root, parent moves away. */
-static void heap_node_swap(heap* heap,
-                           heap_node* parent,
-                           heap_node* child) {
-  heap_node* sibling;
-  heap_node t;
-
-  t = *parent;
-  *parent = *child;
-  *child = t;
-
-  parent->parent = child;
-  if (child->left == child) {
-    child->left = parent;
-    sibling = child->right;
-  } else {
-    child->right = parent;
-    sibling = child->left;
-  }
-  if (sibling != nullptr)
-    sibling->parent = child;
-
-  if (parent->left != nullptr)
-    parent->left->parent = parent;
-  if (parent->right != nullptr)
-    parent->right->parent = parent;
-
-  if (child->parent == nullptr)
-    heap->min = child;
-  else if (child->parent->left == parent)
-    child->parent->left = child;
-  else
-    child->parent->right = child;
+HEAP_EXPORT const heap_node* heap_min(const heap* heap) {
+  if (heap->nelts == 0)
+    return nullptr;
+
+  return &heap->nodes[0];
 }
 
-HEAP_EXPORT void heap_insert(heap* heap,
-                             heap_node* newnode,
-                             heap_compare_fn less_than) {
-  heap_node** parent;
-  heap_node** child;
-  unsigned int path;
-  unsigned int n;
-  unsigned int k;
-
-  newnode->left = nullptr;
-  newnode->right = nullptr;
-  newnode->parent = nullptr;
-
-  /* Calculate the path from the root to the insertion point.  This is a min
-   * heap so we always insert at the left-most free node of the bottom row.
+/* Return non-zero if a < b. */
+static int heap_less_than(const heap_node* a, const heap_node* b) {
+  if (a->timeout != b->timeout)
+    return a->timeout < b->timeout;
+
+  /* Compare start_id when both have the same timeout. start_id is
+   * allocated with loop->timer_counter in uv_timer_start().
    */
-  path = 0;
-  for (k = 0, n = 1 + heap->nelts; n >= 2; k += 1, n /= 2)
-    path = (path << 1) | (n & 1);
-
-  /* Now traverse the heap using the path we calculated in the previous step. */
-  parent = child = &heap->min;
-  while (k > 0) {
-    parent = child;
-    if (path & 1)
-      child = &(*child)->right;
-    else
-      child = &(*child)->left;
-    path >>= 1;
-    k -= 1;
-  }
+  return a->start_id < b->start_id;
+}
 
-  /* Insert the new node. */
-  newnode->parent = *parent;
-  *child = newnode;
-  heap->nelts += 1;
+static unsigned int heap_index(const uv_timer_t* handle) {
+  return (unsigned int) (uintptr_t) handle->heap_node[0];
+}
 
-  /* Walk up the tree and check at each node if the heap property holds.
-   * It's a min heap so parent < child must be true.
-   */
-  while (newnode->parent != nullptr && less_than(newnode, newnode->parent))
-    heap_node_swap(heap, newnode->parent, newnode);
+static void heap_set(heap* heap, unsigned int i, const heap_node* node) {
+  heap->nodes[i] = *node;
+  node->handle->heap_node[0] = (void*) (uintptr_t) i;
 }
 
-HEAP_EXPORT void heap_remove(heap* heap,
-                             heap_node* node,
-                             heap_compare_fn less_than) {
-  heap_node* smallest;
-  heap_node** max;
-  heap_node* child;
-  unsigned int path;
-  unsigned int k;
-  unsigned int n;
+/* Move |node| from slot i towards the root until its parent is smaller. */
+static void heap_sift_up(heap* heap, unsigned int i, heap_node node) {
+  unsigned int parent;
 
-  if (heap->nelts == 0)
-    return;
+  while (i > 0) {
+    parent = (i - 1) / HEAP_ARITY;
+    if (!heap_less_than(&node, &heap->nodes[parent]))
+      break;
 
-  /* Calculate the path from the min (the root) to the max, the left-most node
-   * of the bottom row.
-   */
-  path = 0;
-  for (k = 0, n = heap->nelts; n >= 2; k += 1, n /= 2)
-    path = (path << 1) | (n & 1);
-
-  /* Now traverse the heap using the path we calculated in the previous step. */
-  max = &heap->min;
-  while (k > 0) {
-    if (path & 1)
-      max = &(*max)->right;
-    else
-      max = &(*max)->left;
-    path >>= 1;
-    k -= 1;
+    heap_set(heap, i, &heap->nodes[parent]);
+    i = parent;
   }
 
-  heap->nelts -= 1;
+  heap_set(heap, i, &node);
+}
 
-  /* Unlink the max node. */
-  child = *max;
-  *max = nullptr;
+/* Move |node| from slot i away from the root until its children are larger. */
+static void heap_sift_down(heap* heap, unsigned int i, heap_node node) {
+  unsigned int smallest;
+  unsigned int child;
+  unsigned int first;
+  unsigned int last;
 
-  if (child == node) {
-    /* We're removing either the max or the last node in the tree. */
-    if (child == heap->min) {
-      heap->min = nullptr;
-    }
-    return;
-  }
+  for (;;) {
+    first = HEAP_ARITY * i + 1;
+    if (first >= heap->nelts)
+      break;
 
-  /* Replace the to be deleted node with the max node. */
-  child->left = node->left;
-  child->right = node->right;
-  child->parent = node->parent;
+    last = first + HEAP_ARITY;
+    if (last > heap->nelts)
+      last = heap->nelts;
 
-  if (child->left != nullptr) {
-    child->left->parent = child;
-  }
+    smallest = first;
+    for (child = first + 1; child < last; child++)
+      if (heap_less_than(&heap->nodes[child], &heap->nodes[smallest]))
+        smallest = child;
 
-  if (child->right != nullptr) {
-    child->right->parent = child;
-  }
+    if (!heap_less_than(&heap->nodes[smallest], &node))
+      break;
 
-  if (node->parent == nullptr) {
-    heap->min = child;
-  } else if (node->parent->left == node) {
-    node->parent->left = child;
-  } else {
-    node->parent->right = child;
+    heap_set(heap, i, &heap->nodes[smallest]);
+    i = smallest;
   }
 
-  /* Walk down the subtree and check at each node if the heap property holds.
-   * It's a min heap so parent < child must be true.  If the parent is bigger,
-   * swap it with the smallest child.
-   */
-  for (;;) {
-    smallest = child;
-    if (child->left != nullptr && less_than(child->left, smallest))
-      smallest = child->left;
-    if (child->right != nullptr && less_than(child->right, smallest))
-      smallest = child->right;
-    if (smallest == child)
-      break;
-    heap_node_swap(heap, child, smallest);
+  heap_set(heap, i, &node);
+}
+
+HEAP_EXPORT int heap_insert(heap* heap, uv_timer_t* handle) {
+  heap_node* nodes;
+  heap_node node;
+  unsigned int size;
+
+  if (heap->nelts == heap->size) {
+    size = heap->size == 0 ? HEAP_MIN_SIZE : 2 * heap->size;
+    nodes = (heap_node*) uv__realloc(heap->nodes, size * sizeof(*nodes));
+    if (nodes == nullptr)
+      return UV_ENOMEM;
+
+    heap->nodes = nodes;
+    heap->size = size;
   }
 
-  /* Walk up the subtree and check that each parent is less than the node
-   * this is required, because `max` node is not guaranteed to be the
-   * actual maximum in tree
-   */
-  while (child->parent != nullptr && less_than(child, child->parent))
-    heap_node_swap(heap, child->parent, child);
+  node.timeout = handle->timeout;
+  node.start_id = handle->start_id;
+  node.handle = handle;
+
+  heap->nelts += 1;
+  heap_sift_up(heap, heap->nelts - 1, node);
+
+  return 0;
 }
 
-HEAP_EXPORT void heap_dequeue(struct heap* heap, heap_compare_fn less_than) {
-  heap_remove(heap, heap->min, less_than);
+HEAP_EXPORT void heap_remove(heap* heap, uv_timer_t* handle) {
+  unsigned int parent;
+  unsigned int i;
+  heap_node last;
+
+  i = heap_index(handle);
+  assert(i < heap->nelts);
+  assert(heap->nodes[i].handle == handle);
+
+  heap->nelts -= 1;
+  if (i == heap->nelts)
+    return;
+
+  /* Fill the hole with the last node and restore the heap property, the last
+   * node may have to move either way.
+   */
+  last = heap->nodes[heap->nelts];
+  parent = (i - 1) / HEAP_ARITY;
+  if (i > 0 && heap_less_than(&last, &heap->nodes[parent]))
+    heap_sift_up(heap, i, last);
+  else
+    heap_sift_down(heap, i, last);
 }
 
 #undef HEAP_EXPORT
@@ -26,26 +26,172 @@
 # include "unix/internal.h"
 #endif
 
+#include <atomic>
 #include <stdlib.h>
 
 
 #define MAX_THREADPOOL_SIZE 1024
 
+/* A thread is added when a request has to wait this long for one. */
+#define THREADPOOL_GROW_THRESHOLD ((uint64_t) 10 * 1000 * 1000)
+
+/* Threads above the minimum exit when they've been idle for this long. */
+#define THREADPOOL_IDLE_TIMEOUT ((uint64_t) 5 * 1000 * 1000 * 1000)
+
+/* A priority class that has work waiting gets at least every this many
+ * picks, however much work there is in the classes above it.
+ */
+#define THREADPOOL_STARVATION_LIMIT 8
+
+/* NUMA nodes beyond this share the stacks of the first ones. */
+#define MAX_NUMA_NODES 8
+
+#define NUM_WORK_KINDS UV_THREADPOOL_WORK_KIND_MAX
+#define NUM_BUCKETS UV_THREADPOOL_HISTOGRAM_SIZE
+
+/* Work is handed to the threads through a lock-free stack that the loop
+ * threads push onto. A thread that runs out of work steals from the queues
+ * of the others, and when there's nothing to steal it takes the whole stack
+ * and moves it into its own queue. Older work is thus picked up before newer
+ * work, like with a single queue.
+ *
+ * Slow I/O work goes into a queue of its own, a message is posted in its
+ * place that tells the thread that picks it up to run the oldest slow I/O
+ * request. That keeps slow I/O from occupying more than half of the threads.
+ *
+ * A request's `owner` is the queue that it's on. Requests on the stack belong
+ * to its pseudo-queue in `injected_queue`, which only provides the mutex
+ * that is held while they're moved to a real queue. Once set to a real queue,
+ * `owner` doesn't change until the request is submitted again, uv_cancel()
+ * relies on that.
+ *
+ * Whether a request runs or is cancelled is decided by its `state` alone. A
+ * thread claims a request when it takes it off a queue, uv_cancel() claims
+ * it without any lock and only takes the mutex of the queue to unlink it.
+ * Requests that a thread finds cancelled are skipped, uv_cancel() reports
+ * them to the loop once it holds the queue mutex, after the thread is done
+ * with them.
+ *
+ * The number of threads moves between `min_threads` and `max_threads`. When
+ * a request is submitted and no thread is idle, a thread is started that
+ * waits for THREADPOOL_GROW_THRESHOLD and stays only if there is still work
+ * by then. Threads are kept in slots that are never freed, a thread that
+ * exits leaves its slot to the next one. The thread in slot 0 never exits.
+ *
+ * Work at high or low priority doesn't take the path above, it goes into a
+ * queue per class that all threads share. Threads look at the high priority
+ * queue first and at the low priority one last, the starvation limit keeps
+ * the lower classes moving.
+ *
+ * Threads can be pinned to CPUs with uv_threadpool_set_affinity(), and
+ * grouped per NUMA node. There is a stack for every node then, work goes onto
+ * the stack of the node that the submitting thread runs on and a thread of
+ * that node is woken up for it. Threads take work from the stack of their own
+ * node before they look at the others.
+ *
+ * Chunked work yields after every slice by setting `requeue`. The thread that
+ * ran the slice puts it back at the end of the queue it came from, behind the
+ * work that is waiting, so that long jobs don't hold up short ones.
+ *
+ * Every uv_threadpool_t has its own set of all of the above, loops use the
+ * default pool unless they're configured with UV_LOOP_THREADPOOL.
+ */
+struct threadpool;
+
+struct work_queue {
+  uv_mutex_t mutex;
+  QUEUE wq;
+  /* Length of `wq`, for peeking without taking the mutex. */
+  std::atomic<unsigned int> nqueued;
+  threadpool* pool;
+  /* Set for the pseudo-queues that stand for the stacks. */
+  std::atomic<uv__work*>* stack;
+};
+
+struct worker {
+  work_queue queue;
+  /* Idle threads sleep on their own condition variable, not on a shared one.
+   * `wakeups` counts the wake-ups that haven't been consumed yet.
+   */
+  uv_mutex_t mutex;
+  uv_cond_t cond;
+  unsigned int wakeups;
+  std::atomic<int> parked;
+  unsigned int index;
+  std::atomic<unsigned int> node;
+  /* Set while a thread that was added under load hasn't run anything yet. */
+  int probation;
+  /* Protected by the pool mutex. */
+  int active;
+  int joinable;
+  uv_thread_t thread;
+  /* Only written by the thread itself, uv_threadpool_metrics_info() sums
+   * them up while the thread keeps going.
+   */
+  std::atomic<uint64_t> wait_time[NUM_WORK_KINDS][NUM_BUCKETS];
+  std::atomic<uint64_t> run_time[NUM_WORK_KINDS][NUM_BUCKETS];
+};
+
+struct threadpool {
+  uv_mutex_t mutex;
+  std::atomic<unsigned int> nthreads;
+  std::atomic<unsigned int> nslots;
+  std::atomic<unsigned int> min_threads;
+  std::atomic<unsigned int> max_threads;
+  std::atomic<int> growing;
+  std::atomic<int> exiting;
+  std::atomic<unsigned int> parked_workers;
+  /* Requests that have been submitted but haven't started. */
+  std::atomic<unsigned int> queued;
+  /* Successful uv_cancel() calls, and the ones that came too late. */
+  std::atomic<uint64_t> cancelled;
+  std::atomic<uint64_t> cancel_races;
+  std::atomic<uv__work*> injected[MAX_NUMA_NODES];
+  work_queue injected_queue[MAX_NUMA_NODES];
+  std::atomic<unsigned int> nnodes;
+  /* The CPUs of every node, null when the threads aren't pinned. Protected
+   * by `mutex`.
+   */
+  char* node_masks;
+  /* The node of every CPU, only looked at when there's more than one. */
+  unsigned char* cpu_node;
+  work_queue high_queue;
+  work_queue low_queue;
+  /* Picks since the class last had a turn while it had work waiting. */
+  std::atomic<unsigned int> normal_skipped;
+  std::atomic<unsigned int> low_skipped;
+  work_queue slow_io_queue;
+  unsigned int slow_io_work_running;
+  struct uv__work run_slow_work_message;
+  int slow_work_message_state;
+  worker* workers[MAX_THREADPOOL_SIZE];
+  worker default_workers[4];
+};
+
+/* The state of a request, in `uv__work.state`. */
+enum {
+  WORK_QUEUED,
+  WORK_RUNNING,
+  WORK_DONE,
+  WORK_CANCELLED
+};
+
+/* Where `run_slow_work_message` is, protected by the slow I/O queue mutex. */
+enum {
+  SLOW_WORK_MESSAGE_IDLE,
+  SLOW_WORK_MESSAGE_QUEUED,
+  /* Held back until a thread finishes its slow I/O work. */
+  SLOW_WORK_MESSAGE_WAITING
+};
+
 static uv_once_t once = UV_ONCE_INIT;
-static uv_cond_t cond;
-static uv_mutex_t mutex;
-static unsigned int idle_threads;
-static unsigned int slow_io_work_running;
-static unsigned int nthreads;
-static uv_thread_t* threads;
-static uv_thread_t default_threads[4];
-static QUEUE exit_message;
-static QUEUE wq;
-static QUEUE run_slow_work_message;
-static QUEUE slow_io_pending_wq;
-
-static unsigned int slow_work_thread_threshold(void) {
-  return (nthreads + 1) / 2;
+static threadpool default_pool_fields;
+static uv_threadpool_t default_pool;
+
+static void maybe_grow(threadpool* pool);
+
+static unsigned int slow_work_thread_threshold(threadpool* pool) {
+  return (pool->nthreads.load() + 1) / 2;
 }
 
 static void uv__cancelled(struct uv__work* w) {
@@ -54,184 +200,942 @@ static void uv__cancelled(struct uv__work* w) {
 }
 
 
-/* To avoid deadlock with uv_cancel() it's crucial that the worker
- * never holds the global mutex and the loop-local mutex at the same time.
+static void uv__work_sending(struct uv__work* w) {
+  (void)w;
+  abort();
+}
+
+
+/* uv_loop_t and uv__work are plain structs, the fields that the loop shares
+ * with the threads are accessed through std::atomic.
  */
-static void worker(void* arg) {
+template <typename T>
+static std::atomic<T>* atomic_field(T* field) {
+  static_assert(sizeof(std::atomic<T>) == sizeof(T), "not lock-free");
+  return reinterpret_cast<std::atomic<T>*>(field);
+}
+
+
+/* Hand `w` back to its loop. `loop->wq` is a stack that is linked through
+ * `w->wq[1]`, `w->wq[0]` is left alone so that uv_cancel() still sees that
+ * the request isn't queued. Only the thread that finds the stack empty has to
+ * wake up the loop, the others know that it hasn't taken the stack yet.
+ *
+ * `w->work` is set last. uv__work_done() waits for that, the loop can't be
+ * closed under a thread that's still in uv_async_send().
+ */
+static void post_done(struct uv__work* w, void (*work)(struct uv__work* w)) {
+  std::atomic<void*>* wq;
+  uv_loop_t* loop;
+  void* head;
+
+  loop = w->loop;
+  wq = atomic_field(&loop->wq);
+  atomic_field(&w->work)->store(uv__work_sending, std::memory_order_relaxed);
+
+  head = wq->load(std::memory_order_relaxed);
+  do
+    w->wq[1] = head;
+  while (!wq->compare_exchange_weak(head, w));
+
+  if (head == nullptr)
+    uv_async_send(&loop->wq_async);
+
+  atomic_field(&w->work)->store(work, std::memory_order_release);
+}
+
+
+static void work_queue_init(work_queue* queue, threadpool* pool) {
+  if (uv_mutex_init(&queue->mutex))
+    abort();
+
+  QUEUE_INIT(&queue->wq);
+  queue->nqueued.store(0);
+  queue->pool = pool;
+  queue->stack = nullptr;
+}
+
+
+static void work_queue_destroy(work_queue* queue) {
+  uv_mutex_destroy(&queue->mutex);
+}
+
+
+/* Take the oldest request that hasn't been cancelled off the queue and mark
+ * it as running. Must be called with `queue->mutex` held.
+ */
+static struct uv__work* work_queue_pop(work_queue* queue) {
   struct uv__work* w;
+  int state;
   QUEUE* q;
-  int is_slow_work;
 
-  uv_sem_post((uv_sem_t*) arg);
-  arg = nullptr;
+  while (!QUEUE_EMPTY(&queue->wq)) {
+    q = QUEUE_HEAD(&queue->wq);
+    QUEUE_REMOVE(q);
+    QUEUE_INIT(q);  /* Signal uv_cancel() that it's no longer linked. */
+    queue->nqueued--;
+
+    w = QUEUE_DATA(q, struct uv__work, wq);
+    state = WORK_QUEUED;
+    if (atomic_field(&w->state)->compare_exchange_strong(state, WORK_RUNNING))
+      return w;
+  }
 
-  uv_mutex_lock(&mutex);
-  for (;;) {
-    /* `mutex` should always be locked at this point. */
-
-    /* Keep waiting while either no work is present or only slow I/O
-       and we're at the threshold for that. */
-    while (QUEUE_EMPTY(&wq) ||
-           (QUEUE_HEAD(&wq) == &run_slow_work_message &&
-            QUEUE_NEXT(&run_slow_work_message) == &wq &&
-            slow_io_work_running >= slow_work_thread_threshold())) {
-      idle_threads += 1;
-      uv_cond_wait(&cond, &mutex);
-      idle_threads -= 1;
+  return nullptr;
+}
+
+
+/* Push the requests from `first` to `last`, which are already linked from
+ * `last` down to `first`, onto the stack at once.
+ */
+static void push_injected_list(threadpool* pool,
+                               unsigned int node,
+                               struct uv__work* first,
+                               struct uv__work* last) {
+  std::atomic<uv__work*>* stack;
+  struct uv__work* head;
+
+  stack = &pool->injected[node];
+  head = stack->load(std::memory_order_relaxed);
+  do
+    first->wq[0] = head;
+  while (!stack->compare_exchange_weak(head, last));
+}
+
+
+static void push_injected(threadpool* pool,
+                          unsigned int node,
+                          struct uv__work* w) {
+  push_injected_list(pool, node, w, w);
+}
+
+
+static void push_slow_work_message(threadpool* pool) {
+  atomic_field(&pool->run_slow_work_message.state)->store(
+      WORK_QUEUED, std::memory_order_relaxed);
+  push_injected(pool, 0, &pool->run_slow_work_message);
+}
+
+
+static void worker_post(worker* wk) {
+  uv_mutex_lock(&wk->mutex);
+  wk->wakeups++;
+  uv_cond_signal(&wk->cond);
+  uv_mutex_unlock(&wk->mutex);
+}
+
+
+/* Wait for worker_post(), for at most `timeout` nanoseconds unless it's 0.
+ * Returns UV_ETIMEDOUT when nobody posted in time.
+ */
+static int worker_wait(worker* wk, uint64_t timeout) {
+  uint64_t deadline;
+  uint64_t now;
+  int err;
+
+  deadline = uv_hrtime() + timeout;
+  err = 0;
+
+  uv_mutex_lock(&wk->mutex);
+  while (wk->wakeups == 0 && err == 0) {
+    if (timeout == 0) {
+      uv_cond_wait(&wk->cond, &wk->mutex);
+      continue;
     }
 
-    q = QUEUE_HEAD(&wq);
-    if (q == &exit_message) {
-      uv_cond_signal(&cond);
-      uv_mutex_unlock(&mutex);
-      break;
+    now = uv_hrtime();
+    if (now >= deadline)
+      err = UV_ETIMEDOUT;
+    else
+      uv_cond_timedwait(&wk->cond, &wk->mutex, deadline - now);
+  }
+
+  if (wk->wakeups > 0) {
+    wk->wakeups--;
+    err = 0;
+  }
+  uv_mutex_unlock(&wk->mutex);
+
+  return err;
+}
+
+
+/* Wake up one parked thread, one of `node` if there is one. Returns 0 if
+ * there was no parked thread at all.
+ */
+static int wake_worker_on(threadpool* pool, unsigned int node) {
+  unsigned int local;
+  unsigned int n;
+  unsigned int i;
+  worker* wk;
+  int expected;
+
+  if (pool->parked_workers.load() == 0)
+    return 0;
+
+  n = pool->nslots.load();
+  for (local = pool->nnodes.load() > 1; ; local = 0) {
+    for (i = 0; i < n; i++) {
+      wk = pool->workers[i];
+      if (local && wk->node.load() != node)
+        continue;
+
+      expected = 1;
+      if (wk->parked.compare_exchange_strong(expected, 0)) {
+        pool->parked_workers--;
+        worker_post(wk);
+        return 1;
+      }
     }
 
-    QUEUE_REMOVE(q);
-    QUEUE_INIT(q);  /* Signal uv_cancel() that the work req is executing. */
+    if (!local)
+      return 0;
+  }
+}
+
+
+static int wake_worker(threadpool* pool) {
+  return wake_worker_on(pool, 0);
+}
+
+
+/* Wake up a parked thread for each of `n` new requests for `node`. A thread
+ * is added if there aren't enough of them.
+ */
+static void wake_workers(threadpool* pool, unsigned int node, unsigned int n) {
+  while (n > 0 && wake_worker_on(pool, node))
+    n--;
+
+  if (n > 0)
+    maybe_grow(pool);
+}
+
+
+static void wake_all_workers(threadpool* pool) {
+  unsigned int n;
+  unsigned int i;
+  worker* wk;
+  int expected;
+
+  n = pool->nslots.load();
+  for (i = 0; i < n; i++) {
+    wk = pool->workers[i];
+    expected = 1;
+    if (wk->parked.compare_exchange_strong(expected, 0)) {
+      pool->parked_workers--;
+      worker_post(wk);
+    }
+  }
+}
+
+
+/* Move the work on the stack of `from` to `queue`, oldest first. Must be
+ * called with the mutex of `from` held. Returns the number of requests that
+ * were moved.
+ */
+static unsigned int move_injected(work_queue* queue, work_queue* from) {
+  struct uv__work* w;
+  struct uv__work* next;
+  unsigned int n;
+  QUEUE stack;
+
+  uv_mutex_lock(&queue->mutex);
+
+  QUEUE_INIT(&stack);
+  n = 0;
+  for (w = from->stack->exchange(nullptr); w != nullptr; w = next) {
+    next = static_cast<struct uv__work*>(w->wq[0]);
+    atomic_field(&w->owner)->store(queue, std::memory_order_relaxed);
+    QUEUE_INSERT_HEAD(&stack, &w->wq);
+    n++;
+  }
+
+  if (n > 0) {
+    QUEUE_ADD(&queue->wq, &stack);
+    queue->nqueued += n;
+  }
+
+  uv_mutex_unlock(&queue->mutex);
+
+  return n;
+}
+
+
+static unsigned int take_injected(work_queue* queue, work_queue* from) {
+  unsigned int n;
+
+  if (from->stack->load() == nullptr)
+    return 0;
+
+  uv_mutex_lock(&from->mutex);
+  n = move_injected(queue, from);
+  uv_mutex_unlock(&from->mutex);
+
+  return n;
+}
+
+
+/* Called when a thread picks up `run_slow_work_message`. */
+static struct uv__work* take_slow_io_work(threadpool* pool) {
+  struct uv__work* w;
+  int more;
+
+  uv_mutex_lock(&pool->slow_io_queue.mutex);
+
+  /* If we're at the slow I/O threshold, re-schedule when a thread is done
+   * with its slow I/O work.
+   */
+  if (pool->slow_io_work_running >= slow_work_thread_threshold(pool)) {
+    pool->slow_work_message_state = SLOW_WORK_MESSAGE_WAITING;
+    uv_mutex_unlock(&pool->slow_io_queue.mutex);
+    return nullptr;
+  }
+
+  /* There is none to run if it was cancelled. */
+  w = work_queue_pop(&pool->slow_io_queue);
+  if (w != nullptr)
+    pool->slow_io_work_running++;
+
+  /* If there is more slow I/O work, schedule it to be run as well. */
+  more = !QUEUE_EMPTY(&pool->slow_io_queue.wq);
+  if (more)
+    push_slow_work_message(pool);
+  else
+    pool->slow_work_message_state = SLOW_WORK_MESSAGE_IDLE;
+
+  uv_mutex_unlock(&pool->slow_io_queue.mutex);
+
+  if (more)
+    wake_worker(pool);
+
+  return w;
+}
+
+
+static void slow_io_work_done(threadpool* pool) {
+  int more;
+
+  uv_mutex_lock(&pool->slow_io_queue.mutex);
+  pool->slow_io_work_running--;
+
+  more = 0;
+  if (pool->slow_work_message_state == SLOW_WORK_MESSAGE_WAITING) {
+    more = !QUEUE_EMPTY(&pool->slow_io_queue.wq);
+    if (more) {
+      pool->slow_work_message_state = SLOW_WORK_MESSAGE_QUEUED;
+      push_slow_work_message(pool);
+    } else {
+      pool->slow_work_message_state = SLOW_WORK_MESSAGE_IDLE;
+    }
+  }
+
+  uv_mutex_unlock(&pool->slow_io_queue.mutex);
+
+  if (more)
+    wake_worker(pool);
+}
+
+
+static struct uv__work* steal_work(worker* self) {
+  struct uv__work* w;
+  threadpool* pool;
+  worker* victim;
+  unsigned int n;
+  unsigned int i;
+
+  pool = self->queue.pool;
+  n = pool->nslots.load();
+  for (i = 1; i < n; i++) {
+    victim = pool->workers[(self->index + i) % n];
+    if (victim->queue.nqueued.load() == 0)
+      continue;
+
+    uv_mutex_lock(&victim->queue.mutex);
+    w = work_queue_pop(&victim->queue);
+    uv_mutex_unlock(&victim->queue.mutex);
+
+    if (w != nullptr) {
+      if (victim->queue.nqueued.load() != 0 && !wake_worker(pool))
+        maybe_grow(pool);
+      return w;
+    }
+  }
+
+  return nullptr;
+}
+
+
+static struct uv__work* next_normal_work(worker* self) {
+  struct uv__work* w;
+  threadpool* pool;
+  unsigned int node;
+  unsigned int i;
+
+  if (self->queue.nqueued.load() != 0) {
+    uv_mutex_lock(&self->queue.mutex);
+    w = work_queue_pop(&self->queue);
+    uv_mutex_unlock(&self->queue.mutex);
+    if (w != nullptr)
+      goto found;
+  }
+
+  w = steal_work(self);
+  if (w != nullptr)
+    return w;
+
+  /* The stack of our own node first. */
+  pool = self->queue.pool;
+  node = self->node.load();
+  for (i = 0; i < MAX_NUMA_NODES; i++) {
+    if (take_injected(&self->queue,
+                      &pool->injected_queue[(node + i) % MAX_NUMA_NODES]) > 0) {
+      uv_mutex_lock(&self->queue.mutex);
+      w = work_queue_pop(&self->queue);
+      uv_mutex_unlock(&self->queue.mutex);
+      if (w != nullptr)
+        goto found;
+    }
+  }
+
+  return nullptr;
+
+found:
+  /* Let another thread help out with the rest. */
+  if (self->queue.nqueued.load() != 0 && !wake_worker(self->queue.pool))
+    maybe_grow(self->queue.pool);
+
+  return w;
+}
+
+
+/* Take the oldest request from a queue that all threads share. */
+static struct uv__work* pop_shared(work_queue* queue) {
+  struct uv__work* w;
+  unsigned int more;
+
+  if (queue->nqueued.load() == 0)
+    return nullptr;
+
+  uv_mutex_lock(&queue->mutex);
+  w = work_queue_pop(queue);
+  more = queue->nqueued.load();
+  uv_mutex_unlock(&queue->mutex);
+
+  if (w != nullptr && more != 0 && !wake_worker(queue->pool))
+    maybe_grow(queue->pool);
+
+  return w;
+}
+
+
+static int normal_work_pending(worker* self) {
+  threadpool* pool;
+  unsigned int i;
+
+  if (self->queue.nqueued.load() != 0)
+    return 1;
+
+  pool = self->queue.pool;
+  for (i = 0; i < MAX_NUMA_NODES; i++)
+    if (pool->injected[i].load() != nullptr)
+      return 1;
+
+  return 0;
+}
+
+
+static struct uv__work* next_work(worker* self) {
+  struct uv__work* w;
+  threadpool* pool;
+  int skip_high;
+
+  pool = self->queue.pool;
+
+  if (pool->low_queue.nqueued.load() != 0 &&
+      ++pool->low_skipped >= THREADPOOL_STARVATION_LIMIT) {
+    pool->low_skipped.store(0);
+    w = pop_shared(&pool->low_queue);
+    if (w != nullptr)
+      return w;
+  }
+
+  skip_high = 0;
+  if (pool->high_queue.nqueued.load() != 0 &&
+      normal_work_pending(self) &&
+      ++pool->normal_skipped >= THREADPOOL_STARVATION_LIMIT) {
+    pool->normal_skipped.store(0);
+    skip_high = 1;
+  }
+
+  if (!skip_high) {
+    w = pop_shared(&pool->high_queue);
+    if (w != nullptr)
+      return w;
+  }
+
+  w = next_normal_work(self);
+  if (w != nullptr)
+    return w;
+
+  w = pop_shared(&pool->high_queue);
+  if (w != nullptr)
+    return w;
+
+  return pop_shared(&pool->low_queue);
+}
+
+
+/* Bucket 0 counts durations below a microsecond, bucket `i` the ones from
+ * 2^(i-1) up to 2^i microseconds. The last bucket has everything above.
+ */
+static unsigned int histogram_bucket(uint64_t duration) {
+  unsigned int i;
+
+  duration /= 1000;
+  for (i = 0; duration != 0 && i < NUM_BUCKETS - 1; i++)
+    duration >>= 1;
+
+  return i;
+}
+
+
+static void histogram_add(std::atomic<uint64_t>* histogram, uint64_t duration) {
+  std::atomic<uint64_t>* bucket;
+
+  bucket = &histogram[histogram_bucket(duration)];
+  bucket->store(bucket->load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+}
+
+
+/* Called by a thread that has nothing to do. Returns 1 if it should exit,
+ * `idle` is set when it has been idle for a while.
+ */
+static int worker_retire(worker* self, int idle) {
+  threadpool* pool;
+  unsigned int n;
+  int retire;
+
+  pool = self->queue.pool;
+  uv_mutex_lock(&pool->mutex);
+  n = pool->nthreads.load();
+  retire = self->index != 0 &&
+           (n > pool->max_threads.load() ||
+            (idle && n > pool->min_threads.load()));
+  if (retire) {
+    self->active = 0;
+    pool->nthreads--;
+  }
+  uv_mutex_unlock(&pool->mutex);
+
+  return retire;
+}
+
+
+/* Put work that yielded back in its queue, behind everything that waits.
+ * Normal work also goes behind the work that is still on the stacks, they're
+ * emptied into the queue first. `owner` stays the same, uv_cancel() can take
+ * the work off the queue between two slices like any other queued work.
+ */
+static void requeue(threadpool* pool, struct uv__work* w) {
+  work_queue* queue;
+  unsigned int i;
+
+  queue = static_cast<work_queue*>(w->owner);
+  pool->queued++;
+
+  if (queue != &pool->high_queue && queue != &pool->low_queue)
+    for (i = 0; i < MAX_NUMA_NODES; i++)
+      take_injected(queue, &pool->injected_queue[i]);
+
+  /* Not before it's linked, uv_cancel() unlinks it once it has claimed it. */
+  uv_mutex_lock(&queue->mutex);
+  QUEUE_INSERT_TAIL(&queue->wq, &w->wq);
+  queue->nqueued++;
+  atomic_field(&w->state)->store(WORK_QUEUED, std::memory_order_relaxed);
+  uv_mutex_unlock(&queue->mutex);
+}
+
+
+static void worker_main(void* arg) {
+  struct uv__work* w;
+  threadpool* pool;
+  worker* self;
+  uint64_t start;
+  uint64_t end;
+  int is_slow_work;
+  int expected;
+
+  self = static_cast<worker*>(arg);
+  pool = self->queue.pool;
+
+  if (self->probation) {
+    /* Give the other threads a chance to catch up first. */
+    worker_wait(self, THREADPOOL_GROW_THRESHOLD);
+    pool->growing.store(0);
+  }
+
+  for (;;) {
+    w = next_work(self);
+
+    if (w == nullptr) {
+      if (pool->exiting.load())
+        break;
+
+      if (worker_retire(self, self->probation))
+        break;
+
+      /* Announce that we're about to sleep before looking for work one more
+       * time, a submitter either sees the announcement or we see its work.
+       * The count goes up first so that it never lags behind the flags.
+       */
+      pool->parked_workers++;
+      self->parked.store(1);
+
+      w = next_work(self);
+      if (w == nullptr && !pool->exiting.load()) {
+        if (worker_wait(self, THREADPOOL_IDLE_TIMEOUT) == 0)
+          continue;
+
+        expected = 1;
+        if (!self->parked.compare_exchange_strong(expected, 0)) {
+          worker_wait(self, 0);  /* Someone is waking us up after all. */
+          continue;
+        }
+
+        pool->parked_workers--;
+        if (worker_retire(self, 1))
+          break;
 
-    is_slow_work = 0;
-    if (q == &run_slow_work_message) {
-      /* If we're at the slow I/O threshold, re-schedule until after all
-         other work in the queue is done. */
-      if (slow_io_work_running >= slow_work_thread_threshold()) {
-        QUEUE_INSERT_TAIL(&wq, q);
         continue;
       }
 
-      /* If we encountered a request to run slow I/O work but there is none
-         to run, that means it's cancelled => Start over. */
-      if (QUEUE_EMPTY(&slow_io_pending_wq))
+      expected = 1;
+      if (self->parked.compare_exchange_strong(expected, 0))
+        pool->parked_workers--;
+      else
+        worker_wait(self, 0);  /* Someone woke us up, consume the post. */
+
+      if (w == nullptr)
         continue;
+    }
+
+    self->probation = 0;
 
+    is_slow_work = 0;
+    if (w == &pool->run_slow_work_message) {
+      w = take_slow_io_work(pool);
+      if (w == nullptr)
+        continue;
       is_slow_work = 1;
-      slow_io_work_running++;
+    }
 
-      q = QUEUE_HEAD(&slow_io_pending_wq);
-      QUEUE_REMOVE(q);
-      QUEUE_INIT(q);
+    pool->queued--;
 
-      /* If there is more slow I/O work, schedule it to be run as well. */
-      if (!QUEUE_EMPTY(&slow_io_pending_wq)) {
-        QUEUE_INSERT_TAIL(&wq, &run_slow_work_message);
-        if (idle_threads > 0)
-          uv_cond_signal(&cond);
-      }
+    if (w->submit_time == 0) {
+      w->work(w);
+    } else {
+      start = uv_hrtime();
+      histogram_add(self->wait_time[w->kind], start - w->submit_time);
+      w->work(w);
+      end = uv_hrtime();
+      histogram_add(self->run_time[w->kind], end - start);
     }
 
-    uv_mutex_unlock(&mutex);
-
-    w = QUEUE_DATA(q, struct uv__work, wq);
-    w->work(w);
-
-    uv_mutex_lock(&w->loop->wq_mutex);
-    w->work = nullptr;  /* Signal uv_cancel() that the work req is done
-                        executing. */
-    QUEUE_INSERT_TAIL(&w->loop->wq, &w->wq);
-    uv_async_send(&w->loop->wq_async);
-    uv_mutex_unlock(&w->loop->wq_mutex);
-
-    /* Lock `mutex` since that is expected at the start of the next
-     * iteration. */
-    uv_mutex_lock(&mutex);
-    if (is_slow_work) {
-      /* `slow_io_work_running` is protected by `mutex`. */
-      slow_io_work_running--;
+    if (w->requeue) {
+      w->requeue = 0;
+      if (w->submit_time != 0)
+        w->submit_time = uv_hrtime();
+      requeue(pool, w);
+    } else {
+      atomic_field(&w->state)->store(WORK_DONE, std::memory_order_relaxed);
+      post_done(w, nullptr);
     }
+
+    if (is_slow_work)
+      slow_io_work_done(pool);
   }
 }
 
 
-static void post(QUEUE* q, enum uv__work_kind kind) {
-  uv_mutex_lock(&mutex);
-  if (kind == UV__WORK_SLOW_IO) {
+/* Start a thread in a free slot. Must be called with the pool mutex held. */
+static int spawn_worker(threadpool* pool, int probation) {
+  uv_thread_options_t options;
+  unsigned int n;
+  unsigned int i;
+  worker* wk;
+  int err;
+
+  n = pool->nslots.load();
+  for (i = 0; i < n; i++)
+    if (!pool->workers[i]->active)
+      break;
+
+  if (i == MAX_THREADPOOL_SIZE)
+    return UV_EAGAIN;
+
+  if (i == n) {
+    /* A fresh slot, or one that's left over from before a fork. */
+    wk = pool->workers[i];
+    if (wk == nullptr && i < ARRAY_SIZE(pool->default_workers))
+      wk = &pool->default_workers[i];
+    if (wk == nullptr)
+      wk = create_ptrstruct<worker>(sizeof(*wk));
+    if (wk == nullptr)
+      return UV_ENOMEM;
+
+    work_queue_init(&wk->queue, pool);
+    if (uv_mutex_init(&wk->mutex))
+      abort();
+    if (uv_cond_init(&wk->cond))
+      abort();
+    wk->wakeups = 0;
+    wk->parked.store(0);
+    wk->index = i;
+    wk->active = 0;
+    wk->joinable = 0;
+
+    pool->workers[i] = wk;
+    pool->nslots.store(i + 1);
+  }
+
+  wk = pool->workers[i];
+  if (wk->joinable) {
+    if (uv_thread_join(&wk->thread))
+      abort();
+    wk->joinable = 0;
+    wk->wakeups = 0;
+  }
+
+  wk->node.store(i % pool->nnodes.load());
+
+  options.flags = UV_THREAD_NO_FLAGS;
+  if (pool->node_masks != nullptr) {
+    options.flags |= UV_THREAD_HAS_AFFINITY;
+    options.mask_size = uv_cpumask_size();
+    options.cpumask = pool->node_masks + wk->node.load() * options.mask_size;
+  }
+
+  wk->probation = probation;
+  err = uv_thread_create_ex(&wk->thread, &options, worker_main, wk);
+  if (err)
+    return err;
+
+  wk->active = 1;
+  wk->joinable = 1;
+  pool->nthreads++;
+
+  return 0;
+}
+
+
+/* Called when no thread was idle to take new work. */
+static void maybe_grow(threadpool* pool) {
+  if (pool->nthreads.load() >= pool->max_threads.load() ||
+      pool->growing.load()) {
+    return;
+  }
+
+  uv_mutex_lock(&pool->mutex);
+  if (!pool->growing.load() &&
+      !pool->exiting.load() &&
+      pool->nthreads.load() < pool->max_threads.load() &&
+      spawn_worker(pool, 1) == 0) {
+    pool->growing.store(1);
+  }
+  uv_mutex_unlock(&pool->mutex);
+}
+
+
+/* Returns nullptr for normal priority, that work is distributed over the
+ * queues of the threads.
+ */
+static work_queue* priority_queue(threadpool* pool, int priority) {
+  if (priority == UV_WORK_PRIORITY_HIGH)
+    return &pool->high_queue;
+
+  if (priority == UV_WORK_PRIORITY_LOW)
+    return &pool->low_queue;
+
+  return nullptr;
+}
+
+
+/* The node of the CPU that the calling thread runs on. */
+static unsigned int submit_node(threadpool* pool) {
+  int cpu;
+
+  if (pool->nnodes.load(std::memory_order_acquire) < 2)
+    return 0;
+
+  cpu = uv_thread_getcpu();
+  if (cpu < 0 || cpu >= uv_cpumask_size())
+    return 0;
+
+  return pool->cpu_node[cpu];
+}
+
+
+static void post(threadpool* pool,
+                 struct uv__work* w,
+                 enum uv__work_kind kind,
+                 int priority) {
+  work_queue* queue;
+  unsigned int node;
+
+  pool->queued++;
+
+  queue = priority_queue(pool, priority);
+  if (queue != nullptr) {
+    /* Slow I/O at high or low priority isn't held to the slow I/O limit. */
+    uv_mutex_lock(&queue->mutex);
+    w->owner = queue;
+    QUEUE_INSERT_TAIL(&queue->wq, &w->wq);
+    queue->nqueued++;
+    uv_mutex_unlock(&queue->mutex);
+  } else if (kind == UV__WORK_SLOW_IO) {
     /* Insert into a separate queue. */
-    QUEUE_INSERT_TAIL(&slow_io_pending_wq, q);
-    if (!QUEUE_EMPTY(&run_slow_work_message)) {
+    uv_mutex_lock(&pool->slow_io_queue.mutex);
+    w->owner = &pool->slow_io_queue;
+    QUEUE_INSERT_TAIL(&pool->slow_io_queue.wq, &w->wq);
+    pool->slow_io_queue.nqueued++;
+    if (pool->slow_work_message_state != SLOW_WORK_MESSAGE_IDLE) {
       /* Running slow I/O tasks is already scheduled => Nothing to do here.
          The worker that runs said other task will schedule this one as well. */
-      uv_mutex_unlock(&mutex);
+      uv_mutex_unlock(&pool->slow_io_queue.mutex);
       return;
     }
-    q = &run_slow_work_message;
+    pool->slow_work_message_state = SLOW_WORK_MESSAGE_QUEUED;
+    push_slow_work_message(pool);
+    uv_mutex_unlock(&pool->slow_io_queue.mutex);
+  } else {
+    node = submit_node(pool);
+    w->owner = &pool->injected_queue[node];
+    push_injected(pool, node, w);
+    wake_workers(pool, node, 1);
+    return;
   }
 
-  QUEUE_INSERT_TAIL(&wq, q);
-  if (idle_threads > 0)
-    uv_cond_signal(&cond);
-  uv_mutex_unlock(&mutex);
+  wake_workers(pool, 0, 1);
 }
 
 
-#ifndef _WIN32
-UV_DESTRUCTOR(static void cleanup(void)) {
+static void threadpool_init(threadpool* pool,
+                            unsigned int min_threads,
+                            unsigned int max_threads) {
   unsigned int i;
 
-  if (nthreads == 0)
-    return;
+  if (uv_mutex_init(&pool->mutex))
+    abort();
+
+  for (i = 0; i < MAX_NUMA_NODES; i++) {
+    work_queue_init(&pool->injected_queue[i], pool);
+    pool->injected_queue[i].stack = &pool->injected[i];
+    pool->injected[i].store(nullptr);
+  }
+  pool->nnodes.store(1);
+  pool->node_masks = nullptr;
+  pool->cpu_node = nullptr;
+  work_queue_init(&pool->high_queue, pool);
+  work_queue_init(&pool->low_queue, pool);
+  work_queue_init(&pool->slow_io_queue, pool);
+  pool->normal_skipped.store(0);
+  pool->low_skipped.store(0);
+  pool->queued.store(0);
+  pool->cancelled.store(0);
+  pool->cancel_races.store(0);
+  pool->slow_io_work_running = 0;
+  pool->slow_work_message_state = SLOW_WORK_MESSAGE_IDLE;
+  pool->parked_workers.store(0);
+  pool->exiting.store(0);
+  pool->growing.store(0);
+  pool->nthreads.store(0);
+  pool->nslots.store(0);
+  pool->min_threads.store(min_threads);
+  pool->max_threads.store(max_threads);
+}
+
+
+/* Lets the threads finish the work that's queued and waits for them. */
+static void threadpool_destroy(threadpool* pool) {
+  unsigned int n;
+  unsigned int i;
+  worker* wk;
 
-  post(&exit_message, UV__WORK_CPU);
+  n = pool->nslots.load();
+  pool->exiting.store(1);
+  for (i = 0; i < n; i++)
+    worker_post(pool->workers[i]);
 
-  for (i = 0; i < nthreads; i++)
-    if (uv_thread_join(threads + i))
+  for (i = 0; i < n; i++) {
+    wk = pool->workers[i];
+    if (wk->joinable && uv_thread_join(&wk->thread))
       abort();
+  }
+
+  for (i = 0; i < n; i++) {
+    wk = pool->workers[i];
+    work_queue_destroy(&wk->queue);
+    uv_cond_destroy(&wk->cond);
+    uv_mutex_destroy(&wk->mutex);
+    if (i >= ARRAY_SIZE(pool->default_workers))
+      uv__free(wk);
+    pool->workers[i] = nullptr;
+  }
 
-  if (threads != default_threads)
-    uv__free(threads);
+  work_queue_destroy(&pool->slow_io_queue);
+  work_queue_destroy(&pool->low_queue);
+  work_queue_destroy(&pool->high_queue);
+  for (i = 0; i < MAX_NUMA_NODES; i++)
+    work_queue_destroy(&pool->injected_queue[i]);
 
-  uv_mutex_destroy(&mutex);
-  uv_cond_destroy(&cond);
+  uv__free(pool->node_masks);
+  uv__free(pool->cpu_node);
+  pool->node_masks = nullptr;
+  pool->cpu_node = nullptr;
+  uv_mutex_destroy(&pool->mutex);
+
+  pool->nslots.store(0);
+  pool->nthreads.store(0);
+}
+
+
+#ifndef _WIN32
+UV_DESTRUCTOR(static void cleanup(void)) {
+  if (default_pool.internal_fields == nullptr)
+    return;
 
-  threads = nullptr;
-  nthreads = 0;
+  threadpool_destroy(&default_pool_fields);
+  default_pool.internal_fields = nullptr;
 }
 #endif
 
 
 static void init_threads(void) {
+  threadpool* pool;
+  unsigned int n;
   unsigned int i;
   const char* val;
-  uv_sem_t sem;
 
-  nthreads = ARRAY_SIZE(default_threads);
+  n = ARRAY_SIZE(default_pool_fields.default_workers);
   val = std::getenv("UV_THREADPOOL_SIZE");
   if (val != nullptr)
-    nthreads = atoi(val);
-  if (nthreads == 0)
-    nthreads = 1;
-  if (nthreads > MAX_THREADPOOL_SIZE)
-    nthreads = MAX_THREADPOOL_SIZE;
-
-  threads = default_threads;
-  if (nthreads > ARRAY_SIZE(default_threads)) {
-    threads = create_ptrstruct<uv_thread_t>(nthreads * sizeof(threads[0]));
-    if (threads == nullptr) {
-      nthreads = ARRAY_SIZE(default_threads);
-      threads = default_threads;
-    }
-  }
-
-  if (uv_cond_init(&cond))
-    abort();
-
-  if (uv_mutex_init(&mutex))
-    abort();
-
-  QUEUE_INIT(&wq);
-  QUEUE_INIT(&slow_io_pending_wq);
-  QUEUE_INIT(&run_slow_work_message);
-
-  if (uv_sem_init(&sem, 0))
-    abort();
-
-  for (i = 0; i < nthreads; i++)
-    if (uv_thread_create(threads + i, worker, &sem))
+    n = atoi(val);
+  if (n == 0)
+    n = 1;
+  if (n > MAX_THREADPOOL_SIZE)
+    n = MAX_THREADPOOL_SIZE;
+
+  /* The pool has a fixed size unless uv_threadpool_set_size() says so. */
+  pool = &default_pool_fields;
+  threadpool_init(pool, n, n);
+
+  for (i = 0; i < n; i++)
+    if (spawn_worker(pool, 0))
       abort();
 
-  for (i = 0; i < nthreads; i++)
-    uv_sem_wait(&sem);
-
-  uv_sem_destroy(&sem);
+  default_pool.data = nullptr;
+  default_pool.internal_fields = pool;
 }
 
 
@@ -256,64 +1160,363 @@ static void init_once(void) {
 }
 
 
+uv_threadpool_t* uv_default_threadpool(void) {
+  uv_once(&once, init_once);
+  return &default_pool;
+}
+
+
+int uv_threadpool_init(uv_threadpool_t* pool,
+                       unsigned int min_threads,
+                       unsigned int max_threads) {
+  threadpool* fields;
+  int err;
+
+  if (min_threads == 0 ||
+      min_threads > max_threads ||
+      max_threads > MAX_THREADPOOL_SIZE) {
+    return UV_EINVAL;
+  }
+
+  fields = create_ptrstruct<threadpool>(sizeof(*fields));
+  if (fields == nullptr)
+    return UV_ENOMEM;
+
+  threadpool_init(fields, min_threads, max_threads);
+
+  err = 0;
+  uv_mutex_lock(&fields->mutex);
+  while (err == 0 && fields->nthreads.load() < min_threads)
+    err = spawn_worker(fields, 0);
+  uv_mutex_unlock(&fields->mutex);
+
+  if (err) {
+    threadpool_destroy(fields);
+    uv__free(fields);
+    return err;
+  }
+
+  pool->internal_fields = fields;
+  return 0;
+}
+
+
+int uv_threadpool_close(uv_threadpool_t* pool) {
+  if (pool == &default_pool)
+    return UV_EINVAL;
+
+  threadpool_destroy(static_cast<threadpool*>(pool->internal_fields));
+  uv__free(pool->internal_fields);
+  pool->internal_fields = nullptr;
+
+  return 0;
+}
+
+
+int uv_threadpool_set_size(uv_threadpool_t* pool,
+                           unsigned int min_threads,
+                           unsigned int max_threads) {
+  threadpool* fields;
+  int err;
+
+  if (min_threads == 0 ||
+      min_threads > max_threads ||
+      max_threads > MAX_THREADPOOL_SIZE) {
+    return UV_EINVAL;
+  }
+
+  fields = static_cast<threadpool*>(pool->internal_fields);
+
+  err = 0;
+  uv_mutex_lock(&fields->mutex);
+  fields->min_threads.store(min_threads);
+  fields->max_threads.store(max_threads);
+  while (err == 0 && fields->nthreads.load() < min_threads)
+    err = spawn_worker(fields, 0);
+  uv_mutex_unlock(&fields->mutex);
+
+  /* Idle threads above the new maximum exit when they wake up. */
+  if (fields->nthreads.load() > max_threads)
+    wake_all_workers(fields);
+
+  return err;
+}
+
+
+int uv_threadpool_set_affinity(uv_threadpool_t* pool,
+                               const char* cpumask,
+                               size_t mask_size,
+                               unsigned int flags) {
+  int node_ids[MAX_NUMA_NODES];
+  unsigned char* cpu_node;
+  threadpool* fields;
+  char* node_masks;
+  unsigned int nnodes;
+  unsigned int node;
+  unsigned int n;
+  unsigned int i;
+  int* cpu_ids;
+  worker* wk;
+  int size;
+  int cpu;
+  int err;
+
+  size = uv_cpumask_size();
+  if (size < 0)
+    return size;
+
+  if (cpumask != nullptr && mask_size < static_cast<size_t>(size))
+    return UV_EINVAL;
+
+  cpu_ids = static_cast<int*>(uv__malloc(size * sizeof(*cpu_ids)));
+  node_masks = static_cast<char*>(uv__calloc(MAX_NUMA_NODES, size));
+  cpu_node = static_cast<unsigned char*>(uv__calloc(1, size));
+  if (cpu_ids == nullptr || node_masks == nullptr || cpu_node == nullptr) {
+    uv__free(cpu_ids);
+    uv__free(node_masks);
+    uv__free(cpu_node);
+    return UV_ENOMEM;
+  }
+
+  for (cpu = 0; cpu < size; cpu++)
+    cpu_ids[cpu] = 0;
+
+#if defined(__linux__)
+  if (flags & UV_THREADPOOL_PER_NUMA_NODE)
+    uv__numa_cpu_nodes(cpu_ids, size);
+#endif
+
+  /* Number the nodes that have CPUs in the mask in the order they come up,
+   * nodes beyond MAX_NUMA_NODES share the last one.
+   */
+  nnodes = 0;
+  for (cpu = 0; cpu < size; cpu++) {
+    if (cpumask != nullptr && !cpumask[cpu])
+      continue;
+
+    for (node = 0; node < nnodes; node++)
+      if (node_ids[node] == cpu_ids[cpu])
+        break;
+
+    if (node == nnodes) {
+      if (nnodes < MAX_NUMA_NODES)
+        node_ids[nnodes++] = cpu_ids[cpu];
+      else
+        node = MAX_NUMA_NODES - 1;
+    }
+
+    cpu_node[cpu] = node;
+    node_masks[node * size + cpu] = 1;
+  }
+
+  uv__free(cpu_ids);
+
+  if (nnodes == 0) {
+    uv__free(node_masks);
+    uv__free(cpu_node);
+    return UV_EINVAL;
+  }
+
+  fields = static_cast<threadpool*>(pool->internal_fields);
+
+  uv_mutex_lock(&fields->mutex);
+
+  /* Threads that submit work may be reading the old table, it's updated in
+   * place.
+   */
+  if (fields->cpu_node == nullptr) {
+    fields->cpu_node = cpu_node;
+  } else {
+    memcpy(fields->cpu_node, cpu_node, size);
+    uv__free(cpu_node);
+  }
+
+  uv__free(fields->node_masks);
+  fields->node_masks = node_masks;
+  fields->nnodes.store(nnodes, std::memory_order_release);
+
+  /* The threads that are running move right away. */
+  err = 0;
+  n = fields->nslots.load();
+  for (i = 0; i < n; i++) {
+    wk = fields->workers[i];
+    wk->node.store(i % nnodes);
+    if (wk->active && err == 0)
+      err = uv_thread_setaffinity(&wk->thread,
+                                  node_masks + wk->node.load() * size,
+                                  nullptr,
+                                  size);
+  }
+
+  uv_mutex_unlock(&fields->mutex);
+
+  return err;
+}
+
+
+/* Reading the clock for every request isn't free, work is only timed for
+ * loops that have metrics enabled. Returns 0 for work that isn't timed.
+ */
+static uint64_t submit_time(uv_loop_t* loop) {
+#ifdef _WIN32
+  (void) loop;
+  return 0;
+#else
+  if (!(loop->flags & UV_LOOP_METRICS))
+    return 0;
+
+  return uv_hrtime();
+#endif
+}
+
+
+static threadpool* loop_threadpool(uv_loop_t* loop) {
+  uv_threadpool_t* pool;
+
+  pool = static_cast<uv_threadpool_t*>(loop->threadpool);
+  if (pool == nullptr)
+    pool = uv_default_threadpool();
+
+  return static_cast<threadpool*>(pool->internal_fields);
+}
+
+
+int uv_threadpool_metrics_info(uv_threadpool_t* pool,
+                               uv_threadpool_metrics_t* metrics) {
+  threadpool* fields;
+  unsigned int n;
+  unsigned int i;
+  unsigned int k;
+  unsigned int b;
+  worker* wk;
+
+  if (metrics == nullptr)
+    return UV_EINVAL;
+
+  fields = static_cast<threadpool*>(pool->internal_fields);
+  memset(metrics, 0, sizeof(*metrics));
+
+  metrics->threads = fields->nthreads.load();
+  metrics->idle_threads = fields->parked_workers.load();
+  metrics->queued = fields->queued.load();
+  metrics->cancelled = fields->cancelled.load();
+  metrics->cancel_races = fields->cancel_races.load();
+
+  uv_mutex_lock(&fields->slow_io_queue.mutex);
+  metrics->slow_io_work_running = fields->slow_io_work_running;
+  uv_mutex_unlock(&fields->slow_io_queue.mutex);
+
+  n = fields->nslots.load();
+  for (i = 0; i < n; i++) {
+    wk = fields->workers[i];
+    for (k = 0; k < NUM_WORK_KINDS; k++) {
+      for (b = 0; b < NUM_BUCKETS; b++) {
+        metrics->wait_time[k][b] +=
+            wk->wait_time[k][b].load(std::memory_order_relaxed);
+        metrics->run_time[k][b] +=
+            wk->run_time[k][b].load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  return 0;
+}
+
+
 void uv__work_submit(uv_loop_t* loop,
                      struct uv__work* w,
                      enum uv__work_kind kind,
                      void (*work)(struct uv__work* w),
                      void (*done)(struct uv__work* w, int status)) {
-  uv_once(&once, init_once);
   w->loop = loop;
   w->work = work;
   w->done = done;
-  post(&w->wq, kind);
+  w->kind = kind;
+  w->submit_time = submit_time(loop);
+  w->requeue = 0;
+  w->state = WORK_QUEUED;
+  post(loop_threadpool(loop), w, kind, loop->work_priority);
 }
 
 
 static int uv__work_cancel(uv_loop_t* loop, uv_req_t* req, struct uv__work* w) {
+  (void) loop;
   (void) req;
-  int cancelled;
+  work_queue* queue;
+  work_queue* from;
+  threadpool* pool;
+  int state;
+
+  queue = static_cast<work_queue*>(
+      atomic_field(&w->owner)->load(std::memory_order_relaxed));
+  pool = queue->pool;
+
+  state = WORK_QUEUED;
+  if (!atomic_field(&w->state)->compare_exchange_strong(state,
+                                                        WORK_CANCELLED)) {
+    if (state != WORK_CANCELLED)
+      pool->cancel_races.fetch_add(1, std::memory_order_relaxed);
+    return UV_EBUSY;
+  }
 
-  uv_mutex_lock(&mutex);
-  uv_mutex_lock(&w->loop->wq_mutex);
+  /* No thread runs it anymore, but it may still be linked. Requests that are
+   * on a stack can't be unlinked from it, move them to a queue first. Holding
+   * the mutex of `injected_queue` also waits out a thread that is in the
+   * middle of doing that.
+   */
+  if (queue->stack != nullptr) {
+    from = queue;
+    uv_mutex_lock(&from->mutex);
+    if (w->owner == from && move_injected(&pool->workers[0]->queue, from) > 0)
+      wake_worker(pool);
+    queue = static_cast<work_queue*>(w->owner);
+    uv_mutex_unlock(&from->mutex);
+  }
 
-  cancelled = !QUEUE_EMPTY(&w->wq) && w->work != nullptr;
-  if (cancelled)
+  uv_mutex_lock(&queue->mutex);
+  if (!QUEUE_EMPTY(&w->wq)) {
     QUEUE_REMOVE(&w->wq);
+    QUEUE_INIT(&w->wq);
+    queue->nqueued--;
+  }
+  uv_mutex_unlock(&queue->mutex);
 
-  uv_mutex_unlock(&w->loop->wq_mutex);
-  uv_mutex_unlock(&mutex);
-
-  if (!cancelled)
-    return UV_EBUSY;
-
-  w->work = uv__cancelled;
-  uv_mutex_lock(&loop->wq_mutex);
-  QUEUE_INSERT_TAIL(&loop->wq, &w->wq);
-  uv_async_send(&loop->wq_async);
-  uv_mutex_unlock(&loop->wq_mutex);
+  pool->queued--;
+  pool->cancelled.fetch_add(1, std::memory_order_relaxed);
+  post_done(w, uv__cancelled);
 
   return 0;
 }
 
 
 void uv__work_done(uv_async_t* handle) {
+  void (*work)(struct uv__work* w);
+  struct uv__work* next;
   struct uv__work* w;
   uv_loop_t* loop;
-  QUEUE* q;
-  QUEUE wq;
+  void* head;
   int err;
 
   loop = container_of(handle, uv_loop_t, wq_async);
-  uv_mutex_lock(&loop->wq_mutex);
-  QUEUE_MOVE(&loop->wq, &wq);
-  uv_mutex_unlock(&loop->wq_mutex);
+  head = atomic_field(&loop->wq)->exchange(nullptr);
+
+  /* The stack has the most recently completed request on top, reverse it. */
+  next = nullptr;
+  while (head != nullptr) {
+    w = static_cast<struct uv__work*>(head);
+    head = w->wq[1];
+    w->wq[1] = next;
+    next = w;
+  }
 
-  while (!QUEUE_EMPTY(&wq)) {
-    q = QUEUE_HEAD(&wq);
-    QUEUE_REMOVE(q);
+  for (w = next; w != nullptr; w = next) {
+    next = static_cast<struct uv__work*>(w->wq[1]);
 
-    w = container_of(q, struct uv__work, wq);
-    err = (w->work == uv__cancelled) ? static_cast<std::underlying_type<uv_errno_t>::type>(UV_ECANCELED) : 0;
+    do
+      work = atomic_field(&w->work)->load(std::memory_order_acquire);
+    while (work == uv__work_sending);
+
+    err = (work == uv__cancelled) ? static_cast<std::underlying_type<uv_errno_t>::type>(UV_ECANCELED) : 0;
     w->done(w, err);
   }
 }
@@ -327,15 +1530,23 @@ static void uv__queue_work(struct uv__work* w) {
 
 
 static void uv__queue_done(struct uv__work* w, int err) {
+  uv_work_t* batch;
   uv_work_t* req;
 
   req = container_of(w, uv_work_t, work_req);
   uv__req_unregister(req->loop, req);
 
-  if (req->after_work_cb == nullptr)
+  /* The callback may submit the request again, which clears `batch`. */
+  batch = req->batch;
+
+  if (req->after_work_cb != nullptr)
+    req->after_work_cb(req, err);
+
+  if (batch == nullptr || --batch->batch_pending > 0)
     return;
 
-  req->after_work_cb(req, err);
+  if (batch->after_batch_cb != nullptr)
+    batch->after_batch_cb(batch, batch->batch_size);
 }
 
 
@@ -350,6 +1561,7 @@ int uv_queue_work(uv_loop_t* loop,
   req->loop = loop;
   req->work_cb = work_cb;
   req->after_work_cb = after_work_cb;
+  req->batch = nullptr;
   uv__work_submit(loop,
                   &req->work_req,
                   UV__WORK_CPU,
@@ -359,6 +1571,139 @@ int uv_queue_work(uv_loop_t* loop,
 }
 
 
+static void uv__queue_work_chunk(struct uv__work* w) {
+  uv_work_t* req;
+  int expected;
+
+  req = container_of(w, uv_work_t, work_req);
+  if (req->chunk_cb(req) == 0)
+    return;
+
+  w->requeue = 1;
+
+  /* Only one notification is on its way to the loop at a time, the loop
+   * hears about the progress before it hears that the work is done.
+   */
+  expected = 0;
+  if (req->progress_cb != nullptr &&
+      atomic_field(&req->progress_pending)->compare_exchange_strong(expected,
+                                                                    1)) {
+    post_done(&req->progress_req, nullptr);
+  }
+}
+
+
+static void uv__queue_progress(struct uv__work* w, int status) {
+  uv_work_t* req;
+
+  (void) status;
+  req = container_of(w, uv_work_t, progress_req);
+  atomic_field(&req->progress_pending)->store(0);
+  req->progress_cb(req);
+}
+
+
+int uv_queue_work_batch(uv_loop_t* loop,
+                        uv_work_t reqs[],
+                        unsigned int nreqs,
+                        uv_work_cb work_cb,
+                        uv_after_work_cb after_work_cb,
+                        uv_after_work_batch_cb after_batch_cb) {
+  struct uv__work* w;
+  work_queue* queue;
+  threadpool* pool;
+  unsigned int node;
+  uint64_t now;
+  unsigned int i;
+  QUEUE batch;
+
+  if (work_cb == nullptr || nreqs == 0)
+    return UV_EINVAL;
+
+  pool = loop_threadpool(loop);
+  queue = priority_queue(pool, loop->work_priority);
+  node = queue != nullptr ? 0 : submit_node(pool);
+  QUEUE_INIT(&batch);
+  now = submit_time(loop);
+
+  for (i = 0; i < nreqs; i++) {
+    uv__req_init(loop, &reqs[i], UV_WORK);
+    reqs[i].loop = loop;
+    reqs[i].work_cb = work_cb;
+    reqs[i].after_work_cb = after_work_cb;
+    reqs[i].batch = &reqs[0];
+
+    w = &reqs[i].work_req;
+    w->loop = loop;
+    w->work = uv__queue_work;
+    w->done = uv__queue_done;
+    w->kind = UV__WORK_CPU;
+    w->submit_time = now;
+    w->requeue = 0;
+    w->state = WORK_QUEUED;
+
+    if (queue != nullptr) {
+      w->owner = queue;
+      QUEUE_INSERT_TAIL(&batch, &w->wq);
+    } else {
+      w->owner = &pool->injected_queue[node];
+      if (i > 0)
+        w->wq[0] = &reqs[i - 1].work_req;
+    }
+  }
+
+  reqs[0].batch_size = nreqs;
+  reqs[0].batch_pending = nreqs;
+  reqs[0].after_batch_cb = after_batch_cb;
+
+  pool->queued += nreqs;
+
+  if (queue != nullptr) {
+    uv_mutex_lock(&queue->mutex);
+    QUEUE_ADD(&queue->wq, &batch);
+    queue->nqueued += nreqs;
+    uv_mutex_unlock(&queue->mutex);
+  } else {
+    push_injected_list(pool,
+                       node,
+                       &reqs[0].work_req,
+                       &reqs[nreqs - 1].work_req);
+  }
+
+  wake_workers(pool, node, nreqs);
+
+  return 0;
+}
+
+
+int uv_queue_work_chunked(uv_loop_t* loop,
+                          uv_work_t* req,
+                          uv_work_chunk_cb chunk_cb,
+                          uv_work_progress_cb progress_cb,
+                          uv_after_work_cb after_work_cb) {
+  if (chunk_cb == nullptr)
+    return UV_EINVAL;
+
+  uv__req_init(loop, req, UV_WORK);
+  req->loop = loop;
+  req->work_cb = nullptr;
+  req->after_work_cb = after_work_cb;
+  req->batch = nullptr;
+  req->chunk_cb = chunk_cb;
+  req->progress_cb = progress_cb;
+  req->progress_pending = 0;
+  req->progress_req.loop = loop;
+  req->progress_req.work = nullptr;
+  req->progress_req.done = uv__queue_progress;
+  uv__work_submit(loop,
+                  &req->work_req,
+                  UV__WORK_CPU,
+                  uv__queue_work_chunk,
+                  uv__queue_done);
+  return 0;
+}
+
+
 int uv_cancel(uv_req_t* req) {
   struct uv__work* wreq;
   uv_loop_t* loop;
@@ -0,0 +1,349 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Hierarchical timing wheel, an alternative to the timer heap for loops with
+ * very many timers. Level 0 has a slot for every millisecond of the next 256
+ * milliseconds, every following level has 64 slots that each span all of the
+ * level below it. Timers are moved ("cascaded") one level down when the wheel
+ * below wraps around, until they end up in level 0 where a slot only holds
+ * timers that are due at the same millisecond.
+ *
+ * Timers reuse the storage of uv_timer_t.heap_node: the first two pointers
+ * are the QUEUE that links the timer into its slot, the third points to the
+ * slot itself so that stopping a timer doesn't need to find it first.
+ */
+
+#include "uv.h"
+#include "uv-common.h"
+#include "utils/allocator.cpp"
+
+#include <assert.h>
+#include <string.h>
+
+#define WHEEL_LEVELS 5
+#define WHEEL_L0_BITS 8
+#define WHEEL_LN_BITS 6
+#define WHEEL_L0_SIZE (1u << WHEEL_L0_BITS)
+#define WHEEL_LN_SIZE (1u << WHEEL_LN_BITS)
+#define WHEEL_SLOTS (WHEEL_L0_SIZE + (WHEEL_LEVELS - 1) * WHEEL_LN_SIZE)
+
+/* Timers further out than this are parked in the last slot that's in range,
+ * they're moved further along when that slot is cascaded.
+ */
+#define WHEEL_MAX_DELTA ((uint64_t) 1 << (WHEEL_L0_BITS +                     \
+                         (WHEEL_LEVELS - 1) * WHEEL_LN_BITS))
+
+struct uv__timer_wheel_s {
+  /* The first millisecond that hasn't been processed yet. */
+  uint64_t current;
+  /* Number of timers in the slots, expired timers not included. */
+  uint64_t count;
+  /* Timers that are due, in (timeout, start_id) order. */
+  QUEUE expired;
+  uint64_t occupied[WHEEL_SLOTS / 64];
+  QUEUE slots[WHEEL_SLOTS];
+};
+
+
+static uv__timer_wheel_t* timer_wheel(const uv_loop_t* loop) {
+  return (uv__timer_wheel_t*) loop->timer_wheel;
+}
+
+
+static QUEUE* timer_queue(uv_timer_t* handle) {
+  return (QUEUE*) &handle->heap_node;
+}
+
+
+static unsigned int level_shift(unsigned int level) {
+  if (level == 0)
+    return 0;
+
+  return WHEEL_L0_BITS + (level - 1) * WHEEL_LN_BITS;
+}
+
+
+static unsigned int level_slot(unsigned int level, uint64_t time) {
+  if (level == 0)
+    return time & (WHEEL_L0_SIZE - 1);
+
+  return WHEEL_L0_SIZE +
+         (level - 1) * WHEEL_LN_SIZE +
+         ((time >> level_shift(level)) & (WHEEL_LN_SIZE - 1));
+}
+
+
+static int timer_before(const uv_timer_t* a, const uv_timer_t* b) {
+  if (a->timeout != b->timeout)
+    return a->timeout < b->timeout;
+
+  return a->start_id < b->start_id;
+}
+
+
+static void wheel_expire(uv__timer_wheel_t* wheel, uv_timer_t* handle) {
+  QUEUE* next;
+  QUEUE* q;
+
+  /* Timers are nearly always due later than the ones that are already in the
+   * list, only cascaded timers can come in behind a timer with the same
+   * timeout but a larger start_id.
+   */
+  q = QUEUE_PREV(&wheel->expired);
+  while (q != &wheel->expired &&
+         timer_before(handle, QUEUE_DATA(q, uv_timer_t, heap_node))) {
+    q = QUEUE_PREV(q);
+  }
+
+  next = QUEUE_NEXT(q);
+  QUEUE_INSERT_TAIL(next, timer_queue(handle));
+  handle->heap_node[2] = &wheel->expired;
+}
+
+
+static void wheel_place(uv__timer_wheel_t* wheel, uv_timer_t* handle) {
+  unsigned int level;
+  unsigned int slot;
+  uint64_t delta;
+  uint64_t time;
+
+  time = handle->timeout;
+  if (time < wheel->current) {
+    wheel_expire(wheel, handle);
+    return;
+  }
+
+  delta = time - wheel->current;
+  if (delta >= WHEEL_MAX_DELTA) {
+    delta = WHEEL_MAX_DELTA - 1;
+    time = wheel->current + delta;
+  }
+
+  for (level = 0; level < WHEEL_LEVELS - 1; level++)
+    if (delta < (uint64_t) WHEEL_L0_SIZE << level_shift(level))
+      break;
+
+  slot = level_slot(level, time);
+  QUEUE_INSERT_TAIL(&wheel->slots[slot], timer_queue(handle));
+  handle->heap_node[2] = &wheel->slots[slot];
+  wheel->occupied[slot / 64] |= (uint64_t) 1 << (slot % 64);
+  wheel->count++;
+}
+
+
+static void wheel_unlink(uv__timer_wheel_t* wheel, uv_timer_t* handle) {
+  QUEUE* slot;
+  unsigned int n;
+
+  slot = (QUEUE*) handle->heap_node[2];
+  QUEUE_REMOVE(timer_queue(handle));
+
+  if (slot == &wheel->expired)
+    return;
+
+  wheel->count--;
+  if (QUEUE_EMPTY(slot)) {
+    n = (unsigned int) (slot - wheel->slots);
+    wheel->occupied[n / 64] &= ~((uint64_t) 1 << (n % 64));
+  }
+}
+
+
+/* Empty a slot. The timers in a level 0 slot are due, the ones in the other
+ * levels move down.
+ */
+static void wheel_flush(uv__timer_wheel_t* wheel, unsigned int slot) {
+  uv_timer_t* handle;
+  QUEUE queue;
+  QUEUE* q;
+
+  if (QUEUE_EMPTY(&wheel->slots[slot]))
+    return;
+
+  QUEUE_MOVE(&wheel->slots[slot], &queue);
+  wheel->occupied[slot / 64] &= ~((uint64_t) 1 << (slot % 64));
+
+  while (!QUEUE_EMPTY(&queue)) {
+    q = QUEUE_HEAD(&queue);
+    QUEUE_REMOVE(q);
+    handle = QUEUE_DATA(q, uv_timer_t, heap_node);
+    wheel->count--;
+
+    if (slot < WHEEL_L0_SIZE)
+      wheel_expire(wheel, handle);
+    else
+      wheel_place(wheel, handle);
+  }
+}
+
+
+static int wheel_level0_empty(const uv__timer_wheel_t* wheel) {
+  unsigned int i;
+
+  for (i = 0; i < WHEEL_L0_SIZE / 64; i++)
+    if (wheel->occupied[i] != 0)
+      return 0;
+
+  return 1;
+}
+
+
+/* Move every timer that is due at or before |now| to the expired list. */
+static void wheel_advance(uv__timer_wheel_t* wheel, uint64_t now) {
+  unsigned int level;
+  uint64_t span;
+  uint64_t next;
+
+  while (wheel->current <= now) {
+    if (wheel->count == 0) {
+      wheel->current = now + 1;
+      break;
+    }
+
+    if ((wheel->current & (WHEEL_L0_SIZE - 1)) == 0) {
+      for (level = 1; level < WHEEL_LEVELS; level++) {
+        wheel_flush(wheel, level_slot(level, wheel->current));
+        span = (uint64_t) WHEEL_LN_SIZE << level_shift(level);
+        if ((wheel->current & (span - 1)) != 0)
+          break;
+      }
+    }
+
+    wheel_flush(wheel, level_slot(0, wheel->current));
+    wheel->current++;
+
+    /* Skip ahead to the next cascade when nothing is due before it. */
+    if (wheel_level0_empty(wheel)) {
+      next = (wheel->current + WHEEL_L0_SIZE - 1) &
+             ~(uint64_t) (WHEEL_L0_SIZE - 1);
+      wheel->current = next < now + 1 ? next : now + 1;
+    }
+  }
+}
+
+
+int uv__timer_wheel_init(uv_loop_t* loop) {
+  uv__timer_wheel_t* wheel;
+  unsigned int i;
+
+  if (loop->timer_wheel != nullptr)
+    return 0;
+
+  /* Only while there are no timers in the heap. */
+  if (uv__next_timeout(loop) != -1)
+    return UV_EBUSY;
+
+  wheel = create_ptrstruct<uv__timer_wheel_t>(sizeof(*wheel));
+  if (wheel == nullptr)
+    return UV_ENOMEM;
+
+  wheel->current = loop->time;
+  wheel->count = 0;
+  memset(wheel->occupied, 0, sizeof(wheel->occupied));
+  QUEUE_INIT(&wheel->expired);
+  for (i = 0; i < WHEEL_SLOTS; i++)
+    QUEUE_INIT(&wheel->slots[i]);
+
+  loop->timer_wheel = wheel;
+  return 0;
+}
+
+
+void uv__timer_wheel_delete(uv_loop_t* loop) {
+  uv__free(loop->timer_wheel);
+  loop->timer_wheel = nullptr;
+}
+
+
+void uv__timer_wheel_insert(uv_loop_t* loop, uv_timer_t* handle) {
+  wheel_place(timer_wheel(loop), handle);
+}
+
+
+void uv__timer_wheel_remove(uv_loop_t* loop, uv_timer_t* handle) {
+  wheel_unlink(timer_wheel(loop), handle);
+}
+
+
+uint64_t uv__timer_wheel_next(const uv_loop_t* loop) {
+  const uv__timer_wheel_t* wheel;
+  unsigned int level;
+  unsigned int slot;
+  unsigned int i;
+  uint64_t round;
+  uint64_t time;
+  uint64_t next;
+
+  wheel = timer_wheel(loop);
+  if (!QUEUE_EMPTY(&wheel->expired))
+    return 0;
+
+  if (wheel->count == 0)
+    return (uint64_t) -1;
+
+  next = (uint64_t) -1;
+
+  /* A level 0 slot only holds timers that are due at the same millisecond. */
+  if (!wheel_level0_empty(wheel)) {
+    for (i = 0; i < WHEEL_L0_SIZE; i++) {
+      slot = level_slot(0, wheel->current + i);
+      if (wheel->occupied[slot / 64] & ((uint64_t) 1 << (slot % 64))) {
+        next = wheel->current + i;
+        break;
+      }
+    }
+  }
+
+  /* Timers in the other levels aren't due before their slot is cascaded,
+   * waking up then is good enough.
+   */
+  for (level = 1; level < WHEEL_LEVELS; level++) {
+    round = (wheel->current + ((uint64_t) 1 << level_shift(level)) - 1) >>
+            level_shift(level);
+    for (i = 0; i < WHEEL_LN_SIZE; i++) {
+      time = (round + i) << level_shift(level);
+      if (time >= next)
+        break;
+
+      slot = level_slot(level, time);
+      if (wheel->occupied[slot / 64] & ((uint64_t) 1 << (slot % 64))) {
+        next = time;
+        break;
+      }
+    }
+  }
+
+  return next;
+}
+
+
+uv_timer_t* uv__timer_wheel_expired(uv_loop_t* loop) {
+  uv__timer_wheel_t* wheel;
+
+  wheel = timer_wheel(loop);
+  if (wheel->current <= loop->time)
+    wheel_advance(wheel, loop->time);
+
+  if (QUEUE_EMPTY(&wheel->expired))
+    return nullptr;
+
+  return QUEUE_DATA(QUEUE_HEAD(&wheel->expired), uv_timer_t, heap_node);
+}
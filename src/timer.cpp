@@ -35,28 +35,47 @@ static heap *timer_heap(const uv_loop_t* loop) {
 }
 
 
-static int timer_less_than(const heap_node* ha,
-                           const heap_node* hb) {
-  const uv_timer_t* a;
-  const uv_timer_t* b;
+/* Timers started with uv_timer_start_ns(). Their timeout is on the
+ * uv_hrtime() clock, so they can't share the heap with millisecond timers.
+ */
+static heap* hrtimer_heap(const uv_loop_t* loop) {
+  return (heap*) &loop->hrtimer_heap;
+}
 
-  a = container_of(ha, uv_timer_t, heap_node);
-  b = container_of(hb, uv_timer_t, heap_node);
 
-  if (a->timeout < b->timeout)
-    return 1;
-  if (b->timeout < a->timeout)
-    return 0;
+static void hrtimer_rearm(uv_loop_t* loop) {
+  const heap_node* heap_node;
 
-  /* Compare start_id when both have the same timeout. start_id is
-   * allocated with loop->timer_counter in uv_timer_start().
-   */
-  if (a->start_id < b->start_id)
-    return 1;
-  if (b->start_id < a->start_id)
-    return 0;
+  heap_node = heap_min(hrtimer_heap(loop));
+  uv__hrtimer_arm(loop, heap_node == nullptr ? 0 : heap_node->timeout);
+}
 
-  return 0;
+
+/* Pick the due time in [timeout, timeout + slack] with the most trailing zero
+ * bits. Timers whose windows overlap tend to end up on the same millisecond,
+ * and the loop wakes up once for all of them. Timers never run early.
+ */
+static uint64_t timer_coalesce(uint64_t timeout, uint64_t slack) {
+  uint64_t latest;
+  uint64_t mask;
+
+  latest = timeout + slack;
+  if (latest < timeout)
+    latest = (uint64_t) -1;
+
+  if (latest == timeout)
+    return timeout;
+
+  /* Clear every bit below the highest one in which the bounds differ. */
+  mask = timeout ^ latest;
+  mask |= mask >> 1;
+  mask |= mask >> 2;
+  mask |= mask >> 4;
+  mask |= mask >> 8;
+  mask |= mask >> 16;
+  mask |= mask >> 32;
+
+  return latest & ~(mask >> 1);
 }
 
 
@@ -64,6 +83,7 @@ int uv_timer_init(uv_loop_t* loop, uv_timer_t* handle) {
   uv__handle_init(loop, (uv_handle_t*)handle, UV_TIMER);
   handle->timer_cb = nullptr;
   handle->repeat = 0;
+  handle->slack = 0;
   return 0;
 }
 
@@ -73,28 +93,73 @@ int uv_timer_start(uv_timer_t* handle,
                    uint64_t timeout,
                    uint64_t repeat) {
   uint64_t clamped_timeout;
+  int err;
 
   if (uv__is_closing(handle) || cb == nullptr)
     return UV_EINVAL;
 
   if (uv__is_active(handle))
     uv_timer_stop(handle);
+  handle->flags &= ~UV_HANDLE_TIMER_NS;
 
   clamped_timeout = handle->loop->time + timeout;
   if (clamped_timeout < timeout)
     clamped_timeout = (uint64_t) -1;
 
+  handle->timer_cb = cb;
+  handle->timeout = timer_coalesce(clamped_timeout, handle->slack);
+  handle->repeat = repeat;
+  /* start_id is the second index to be compared in heap_less_than() */
+  handle->start_id = handle->loop->timer_counter++;
+
+  if (handle->loop->timer_wheel != nullptr) {
+    uv__timer_wheel_insert(handle->loop, handle);
+  } else {
+    err = heap_insert(timer_heap(handle->loop), handle);
+    if (err)
+      return err;
+  }
+  uv__handle_start(handle);
+
+  return 0;
+}
+
+
+int uv_timer_start_ns(uv_timer_t* handle,
+                      uv_timer_cb cb,
+                      uint64_t timeout,
+                      uint64_t repeat) {
+  const heap_node* heap_node;
+  uint64_t clamped_timeout;
+  int err;
+
+  if (uv__is_closing(handle) || cb == nullptr)
+    return UV_EINVAL;
+
+  if (uv__is_active(handle))
+    uv_timer_stop(handle);
+
+  clamped_timeout = uv_hrtime() + timeout;
+  if (clamped_timeout < timeout)
+    clamped_timeout = (uint64_t) -1;
+
   handle->timer_cb = cb;
   handle->timeout = clamped_timeout;
   handle->repeat = repeat;
-  /* start_id is the second index to be compared in timer_less_than() */
   handle->start_id = handle->loop->timer_counter++;
 
-  heap_insert(timer_heap(handle->loop),
-              (heap_node*) &handle->heap_node,
-              timer_less_than);
+  err = heap_insert(hrtimer_heap(handle->loop), handle);
+  if (err)
+    return err;
+
+  handle->flags |= UV_HANDLE_TIMER_NS;
   uv__handle_start(handle);
 
+  /* Only a new earliest timer moves the wakeup. */
+  heap_node = heap_min(hrtimer_heap(handle->loop));
+  if (heap_node->handle == handle)
+    hrtimer_rearm(handle->loop);
+
   return 0;
 }
 
@@ -103,9 +168,15 @@ int uv_timer_stop(uv_timer_t* handle) {
   if (!uv__is_active(handle))
     return 0;
 
-  heap_remove(timer_heap(handle->loop),
-              (heap_node*) &handle->heap_node,
-              timer_less_than);
+  /* Nanosecond timers don't disarm the wakeup, it's cheaper to take the odd
+   * spurious one.
+   */
+  if (handle->flags & UV_HANDLE_TIMER_NS)
+    heap_remove(hrtimer_heap(handle->loop), handle);
+  else if (handle->loop->timer_wheel != nullptr)
+    uv__timer_wheel_remove(handle->loop, handle);
+  else
+    heap_remove(timer_heap(handle->loop), handle);
   uv__handle_stop(handle);
 
   return 0;
@@ -118,7 +189,13 @@ int uv_timer_again(uv_timer_t* handle) {
 
   if (handle->repeat) {
     uv_timer_stop(handle);
-    uv_timer_start(handle, handle->timer_cb, handle->repeat, handle->repeat);
+    if (handle->flags & UV_HANDLE_TIMER_NS)
+      uv_timer_start_ns(handle,
+                        handle->timer_cb,
+                        handle->repeat,
+                        handle->repeat);
+    else
+      uv_timer_start(handle, handle->timer_cb, handle->repeat, handle->repeat);
   }
 
   return 0;
@@ -135,20 +212,67 @@ uint64_t uv_timer_get_repeat(const uv_timer_t* handle) {
 }
 
 
+void uv_timer_set_slack(uv_timer_t* handle, uint64_t slack) {
+  handle->slack = slack;
+}
+
+
+uint64_t uv_timer_get_slack(const uv_timer_t* handle) {
+  return handle->slack;
+}
+
+
+static int timer_next_timeout(const uv_loop_t* loop) {
+  const heap_node* heap_node;
+  uint64_t timeout;
+  uint64_t diff;
+
+  if (loop->timer_wheel != nullptr) {
+    timeout = uv__timer_wheel_next(loop);
+    if (timeout == (uint64_t) -1)
+      return -1; /* block indefinitely */
+  } else {
+    heap_node = heap_min(timer_heap(loop));
+    if (heap_node == nullptr)
+      return -1; /* block indefinitely */
+
+    timeout = heap_node->timeout;
+  }
+
+  if (timeout <= loop->time)
+    return 0;
+
+  diff = timeout - loop->time;
+  if (diff > INT_MAX)
+    diff = INT_MAX;
+
+  return (int) diff;
+}
+
+
 int uv__next_timeout(const uv_loop_t* loop) {
   const heap_node* heap_node;
-  const uv_timer_t* handle;
+  uint64_t now;
   uint64_t diff;
+  int timeout;
 
-  heap_node = heap_min(timer_heap(loop));
+  timeout = timer_next_timeout(loop);
+
+  heap_node = heap_min(hrtimer_heap(loop));
   if (heap_node == nullptr)
-    return -1; /* block indefinitely */
+    return timeout;
 
-  handle = container_of(heap_node, uv_timer_t, heap_node);
-  if (handle->timeout <= loop->time)
+  now = uv_hrtime();
+  if (heap_node->timeout <= now)
     return 0;
 
-  diff = handle->timeout - loop->time;
+  /* Round up, the poll timeout must not end before the timer is due. Where
+   * the platform has a finer grained wakeup it comes in before this one.
+   */
+  diff = (heap_node->timeout - now + 999999) / 1000000;
+  if (timeout != -1 && (uint64_t) timeout <= diff)
+    return timeout;
+
   if (diff > INT_MAX)
     diff = INT_MAX;
 
@@ -156,23 +280,54 @@ int uv__next_timeout(const uv_loop_t* loop) {
 }
 
 
+void uv__run_hrtimers(uv_loop_t* loop) {
+  const heap_node* heap_node;
+  uv_timer_t* handle;
+  uint64_t now;
+
+  heap_node = heap_min(hrtimer_heap(loop));
+  if (heap_node != nullptr) {
+    /* Timers that are started from a callback wait for the next round, like
+     * the millisecond ones do.
+     */
+    now = uv_hrtime();
+    while (heap_node != nullptr && heap_node->timeout <= now) {
+      handle = heap_node->handle;
+      uv_timer_stop(handle);
+      uv_timer_again(handle);
+      handle->timer_cb(handle);
+      heap_node = heap_min(hrtimer_heap(loop));
+    }
+  }
+
+  hrtimer_rearm(loop);
+}
+
+
 void uv__run_timers(uv_loop_t* loop) {
-  heap_node* heap_node;
+  const heap_node* heap_node;
   uv_timer_t* handle;
 
   for (;;) {
-    heap_node = heap_min(timer_heap(loop));
-    if (heap_node == nullptr)
-      break;
-
-    handle = container_of(heap_node, uv_timer_t, heap_node);
-    if (handle->timeout > loop->time)
-      break;
+    if (loop->timer_wheel != nullptr) {
+      /* All timers that are due come out of the wheel in one go. */
+      handle = uv__timer_wheel_expired(loop);
+      if (handle == nullptr)
+        break;
+    } else {
+      heap_node = heap_min(timer_heap(loop));
+      if (heap_node == nullptr || heap_node->timeout > loop->time)
+        break;
+
+      handle = heap_node->handle;
+    }
 
     uv_timer_stop(handle);
     uv_timer_again(handle);
     handle->timer_cb(handle);
   }
+
+  uv__run_hrtimers(loop);
 }
 
 
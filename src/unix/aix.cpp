@@ -198,6 +198,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
 
   for (;;) {
     pollfd events[1024];
+    uv__metrics_phase(loop, UV_METRICS_PHASE_POLL);
     auto nfds = pollset_poll(loop->backend_fd,
                         events,
                         ARRAY_SIZE(events),
@@ -207,7 +208,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
      * timeout == 0 (i.e. non-blocking poll) but there is no guarantee that the
      * operating system didn't reschedule our process while in the syscall.
      */
-    SAVE_ERRNO(uv__update_time(loop));
+    SAVE_ERRNO(uv__metrics_poll_wakeup(loop, nfds));
 
     if (nfds == 0) {
       assert(timeout != -1);
@@ -39,6 +39,8 @@
 
 static void uv__async_send(uv_loop_t* loop);
 static int uv__async_start(uv_loop_t* loop);
+static int uv__async_push(uv_async_t* handle);
+static void uv__async_take(uv_loop_t* loop);
 
 
 int uv_async_init(uv_loop_t* loop, uv_async_t* handle, uv_async_cb async_cb) {
@@ -50,6 +52,7 @@ int uv_async_init(uv_loop_t* loop, uv_async_t* handle, uv_async_cb async_cb) {
   uv__handle_init(loop, reinterpret_cast<uv_handle_t*>(handle), UV_ASYNC);
   handle->async_cb = async_cb;
   handle->pending = 0;
+  handle->pending_next = nullptr;
 
   QUEUE_INSERT_TAIL(&loop->async_handles, &handle->queue);
   uv__handle_start(handle);
@@ -67,8 +70,11 @@ int uv_async_send(uv_async_t* handle) {
   if (cmpxchgi(&handle->pending, 0, 1) != 0)
     return 0;
 
-  /* Wake up the other thread's event loop. */
-  uv__async_send(handle->loop);
+  /* Wake up the other thread's event loop. Only the sender that finds the
+   * pending list empty has to, the others ride along on its wakeup.
+   */
+  if (uv__async_push(handle))
+    uv__async_send(handle->loop);
 
   /* Tell the other thread we're done. */
   if (cmpxchgi(&handle->pending, 1, 2) != 1)
@@ -97,8 +103,61 @@ static int uv__async_spin(uv_async_t* handle) {
 }
 
 
+/* Senders push signalled handles on loop->async_pending, a lock-free stack
+ * that only the event loop thread takes from, and it takes all of it at
+ * once. A handle is on it for as long as its pending field is non-zero, so
+ * the loop only visits handles that were actually signalled.
+ */
+static int uv__async_push(uv_async_t* handle) {
+  uv_loop_t* loop;
+  void* head;
+
+  loop = handle->loop;
+  do {
+    head = *static_cast<void* volatile*>(&loop->async_pending);
+    handle->pending_next = head;
+  } while (cmpxchgp(&loop->async_pending, head, handle) != head);
+
+  return head == nullptr;
+}
+
+
+/* Only call this from the event loop thread. Moves the handles from the stack
+ * to the end of loop->async_ready, in the order in which they were sent.
+ */
+static void uv__async_take(uv_loop_t* loop) {
+  uv_async_t* handle;
+  QUEUE queue;
+  void* head;
+
+  do
+    head = *static_cast<void* volatile*>(&loop->async_pending);
+  while (head != nullptr &&
+         cmpxchgp(&loop->async_pending, head, nullptr) != head);
+
+  if (head == nullptr)
+    return;
+
+  QUEUE_INIT(&queue);
+  while (head != nullptr) {
+    handle = static_cast<uv_async_t*>(head);
+    head = handle->pending_next;
+    QUEUE_INSERT_HEAD(&queue, &handle->pending_queue);
+  }
+
+  QUEUE_ADD(&loop->async_ready, &queue);
+}
+
+
 void uv__async_close(uv_async_t* handle) {
-  uv__async_spin(handle);
+  /* A pending handle is still on the stack or the ready list, the loop must
+   * not visit it after it's closed.
+   */
+  if (uv__async_spin(handle) != 0) {
+    uv__async_take(handle->loop);
+    QUEUE_REMOVE(&handle->pending_queue);
+  }
+
   QUEUE_REMOVE(&handle->queue);
   uv__handle_stop(handle);
 }
@@ -127,14 +186,15 @@ static void uv__async_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
     abort();
   }
 
-  QUEUE queue;
-  QUEUE_MOVE(&loop->async_handles, &queue);
-  while (!QUEUE_EMPTY(&queue)) {
-    auto q = QUEUE_HEAD(&queue);
-    auto h = QUEUE_DATA(q, uv_async_t, queue);
+  /* Take the pending handles only after draining the fd. A sender that finds
+   * the stack empty afterwards writes to the fd again.
+   */
+  uv__async_take(loop);
+  while (!QUEUE_EMPTY(&loop->async_ready)) {
+    auto q = QUEUE_HEAD(&loop->async_ready);
+    auto h = QUEUE_DATA(q, uv_async_t, pending_queue);
 
     QUEUE_REMOVE(q);
-    QUEUE_INSERT_TAIL(&loop->async_handles, q);
 
     if (0 == uv__async_spin(h))
       continue;  /* Not pending. */
@@ -211,7 +271,15 @@ int uv__async_fork(uv_loop_t* loop) {
 
   uv__async_stop(loop);
 
-  return uv__async_start(loop);
+  auto err = uv__async_start(loop);
+  if (err)
+    return err;
+
+  /* The new fd doesn't know about handles that are still pending. */
+  if (loop->async_pending != nullptr || !QUEUE_EMPTY(&loop->async_ready))
+    uv__async_send(loop);
+
+  return 0;
 }
 
 
@@ -23,6 +23,7 @@
 #endif
 
 UV_UNUSED(static int cmpxchgi(int* ptr, int oldval, int newval));
+UV_UNUSED(static void* cmpxchgp(void** ptr, void* oldval, void* newval));
 UV_UNUSED(static void cpu_relax(void));
 
 /* Prefer hand-rolled assembly over the gcc builtins because the latter also
@@ -50,6 +51,14 @@ UV_UNUSED(static int cmpxchgi(int* ptr, int oldval, int newval)) {
 #endif
 }
 
+UV_UNUSED(static void* cmpxchgp(void** ptr, void* oldval, void* newval)) {
+#if defined(__SUNPRO_C) || defined(__SUNPRO_CC)
+  return atomic_cas_ptr(ptr, oldval, newval);
+#else
+  return __sync_val_compare_and_swap(ptr, oldval, newval);
+#endif
+}
+
 UV_UNUSED(static void cpu_relax(void)) {
 #if defined(__i386__) || defined(__x86_64__)
   __asm__ __volatile__ ("rep; nop");  /* a.k.a. PAUSE */
@@ -325,6 +325,13 @@ int uv_backend_fd(const uv_loop_t* loop) {
 }
 
 
+#if !defined(__linux__)
+void uv__hrtimer_arm(uv_loop_t* loop, uint64_t due) {
+  /* Nothing finer grained than the poll timeout. */
+}
+#endif
+
+
 int uv_backend_timeout(const uv_loop_t* loop) {
   if (loop->stop_flag != 0)
     return 0;
@@ -345,6 +352,31 @@ int uv_backend_timeout(const uv_loop_t* loop) {
 }
 
 
+uint64_t uv_metrics_busy_poll_time(const uv_loop_t* loop) {
+#if defined(__linux__)
+  return loop->busy_poll_time;
+#else
+  (void) loop;
+  return 0;
+#endif
+}
+
+
+uint64_t uv_metrics_idle_time(const uv_loop_t* loop) {
+  return loop->metrics.idle_time;
+}
+
+
+int uv_metrics_info(const uv_loop_t* loop, uv_metrics_t* metrics) {
+  if (metrics == nullptr)
+    return UV_EINVAL;
+
+  *metrics = loop->metrics;
+  metrics->busy_poll_time = uv_metrics_busy_poll_time(loop);
+  return 0;
+}
+
+
 static int uv__loop_alive(const uv_loop_t* loop) {
   return uv__has_active_handles(loop) ||
          uv__has_active_reqs(loop) ||
@@ -367,19 +399,28 @@ int uv_run(uv_loop_t* loop, uv_run_mode mode) {
     uv__update_time(loop);
 
   while (r != 0 && loop->stop_flag == 0) {
+    loop->metrics.loop_count++;
     uv__update_time(loop);
+    uv__metrics_start(loop);
     uv__run_timers(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_TIMERS);
     ran_pending = uv__run_pending(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_PENDING);
     uv__run_idle(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_IDLE);
     uv__run_prepare(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_PREPARE);
 
     timeout = 0;
     if ((mode == UV_RUN_ONCE && !ran_pending) || mode == UV_RUN_DEFAULT)
       timeout = uv_backend_timeout(loop);
 
     uv__io_poll(loop, timeout);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_POLL);
     uv__run_check(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_CHECK);
     uv__run_closing_handles(loop);
+    uv__metrics_phase(loop, UV_METRICS_PHASE_CLOSING);
 
     if (mode == UV_RUN_ONCE) {
       /* UV_RUN_ONCE implies forward progress: at least one callback must have
@@ -392,6 +433,7 @@ int uv_run(uv_loop_t* loop, uv_run_mode mode) {
        */
       uv__update_time(loop);
       uv__run_timers(loop);
+      uv__metrics_phase(loop, UV_METRICS_PHASE_TIMERS);
     }
 
     r = uv__loop_alive(loop);
@@ -907,7 +949,7 @@ void uv__io_stop(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
     return;
 
   w->pevents &= ~events;
-  if (w->pevents == 0) {
+  if ((w->pevents & ~UV__POLLET) == 0) {
     QUEUE_REMOVE(&w->watcher_queue);
     QUEUE_INIT(&w->watcher_queue);
     if (loop->watchers[w->fd] != nullptr) {
@@ -946,6 +988,16 @@ int uv__io_active(const uv__io_t* w, unsigned int events) {
 }
 
 
+void uv__io_set_edge_triggered(uv__io_t* w, int on) {
+  assert(!uv__io_active(w, POLLIN | POLLOUT | UV__POLLRDHUP | UV__POLLPRI));
+
+  if (on)
+    w->pevents |= UV__POLLET;
+  else
+    w->pevents &= ~UV__POLLET;
+}
+
+
 int uv__fd_exists(uv_loop_t* loop, int fd) {
   return (unsigned) fd < loop->nwatchers && loop->watchers[fd] != nullptr;
 }
@@ -126,6 +126,20 @@ int uv__pthread_sigmask(int how, const sigset_t* set, sigset_t* oset);
 # define UV__POLLPRI 0
 #endif
 
+/* Zero-copy TCP transmits, completions arrive on the socket error queue. */
+#if defined(__linux__) && defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+# define UV__HAVE_ZEROCOPY 1
+#endif
+
+/* Not a poll event but a flag for the epoll backend: register the watcher
+ * as edge-triggered.  Sticks in w->pevents until uv__io_init() is called.
+ */
+#if defined(__linux__)
+# define UV__POLLET (1u << 31)  /* EPOLLET */
+#else
+# define UV__POLLET 0
+#endif
+
 #if !defined(O_CLOEXEC) && defined(__FreeBSD__)
 /*
  * It may be that we are just missing `__POSIX_VISIBLE >= 200809`.
@@ -138,7 +152,8 @@ typedef struct uv__stream_queued_fds_s uv__stream_queued_fds_t;
 
 /* loop flags */
 enum {
-  UV_LOOP_BLOCK_SIGPROF = 1
+  UV_LOOP_BLOCK_SIGPROF = 1,
+  UV_LOOP_METRICS = 2
 };
 
 /* flags of excluding ifaddr */
@@ -205,6 +220,7 @@ void uv__io_stop(uv_loop_t* loop, uv__io_t* w, unsigned int events);
 void uv__io_close(uv_loop_t* loop, uv__io_t* w);
 void uv__io_feed(uv_loop_t* loop, uv__io_t* w);
 int uv__io_active(const uv__io_t* w, unsigned int events);
+void uv__io_set_edge_triggered(uv__io_t* w, int on);
 int uv__io_check_fd(uv_loop_t* loop, int fd);
 void uv__io_poll(uv_loop_t* loop, int timeout); /* in milliseconds or -1 */
 int uv__io_fork(uv_loop_t* loop);
@@ -225,6 +241,7 @@ void uv__stream_init(uv_loop_t* loop, uv_stream_t* stream,
     uv_handle_type type);
 int uv__stream_open(uv_stream_t*, int fd, int flags);
 void uv__stream_destroy(uv_stream_t* stream);
+void uv__read_pool_delete(uv_loop_t* loop);
 #if defined(__APPLE__)
 int uv__stream_try_select(uv_stream_t* stream, int* fd);
 #endif /* defined(__APPLE__) */
@@ -237,6 +254,7 @@ int uv__open_cloexec(const char* path, int flags);
 int uv_tcp_listen(uv_tcp_t* tcp, int backlog, uv_connection_cb cb);
 int uv__tcp_nodelay(int fd, int on);
 int uv__tcp_keepalive(int fd, int on, unsigned int delay);
+int uv__tcp_zerocopy(int fd, int on);
 
 /* pipe */
 int uv_pipe_listen(uv_pipe_t* handle, int backlog, uv_connection_cb cb);
@@ -307,6 +325,47 @@ UV_UNUSED(static void uv__update_time(uv_loop_t* loop)) {
   loop->time = uv__hrtime(UV_CLOCK_FAST) / 1000000;
 }
 
+/* Loop metrics. Counters are always kept, the clock is only read when timing
+ * was enabled with UV_LOOP_ENABLE_METRICS. loop->metrics_time is the moment
+ * the phase that is currently running started.
+ */
+UV_UNUSED(static void uv__metrics_start(uv_loop_t* loop)) {
+  if (loop->flags & UV_LOOP_METRICS)
+    loop->metrics_time = uv__hrtime(UV_CLOCK_PRECISE);
+}
+
+UV_UNUSED(static void uv__metrics_phase(uv_loop_t* loop,
+                                        uv_metrics_phase phase)) {
+  uint64_t now;
+
+  if (!(loop->flags & UV_LOOP_METRICS))
+    return;
+
+  now = uv__hrtime(UV_CLOCK_PRECISE);
+  loop->metrics.phase_time[phase] += now - loop->metrics_time;
+  loop->metrics_time = now;
+}
+
+/* Called by the uv__io_poll() implementations instead of uv__update_time()
+ * when the backend returns, the time since the last call to
+ * uv__metrics_phase(loop, UV_METRICS_PHASE_POLL) was spent waiting.
+ */
+UV_UNUSED(static void uv__metrics_poll_wakeup(uv_loop_t* loop, int nfds)) {
+  uint64_t now;
+
+  uv__update_time(loop);
+
+  loop->metrics.event_waits++;
+  if (nfds > 0)
+    loop->metrics.events += nfds;
+
+  if (loop->flags & UV_LOOP_METRICS) {
+    now = uv__hrtime(UV_CLOCK_PRECISE);
+    loop->metrics.idle_time += now - loop->metrics_time;
+    loop->metrics_time = now;
+  }
+}
+
 UV_UNUSED(static char* uv__basename_r(char const* path)) {
   char* s;
 
@@ -319,6 +378,17 @@ UV_UNUSED(static char* uv__basename_r(char const* path)) {
 
 #if defined(__linux__)
 int uv__inotify_fork(uv_loop_t* loop, void* old_watchers);
+int uv__iou_init(uv_loop_t* loop);
+void uv__iou_delete(uv_loop_t* loop);
+void uv__iou_invalidate_fd(uv_loop_t* loop, int fd);
+void uv__iou_poll(uv_loop_t* loop, int timeout);
+void uv__socket_busy_poll(uv_loop_t* loop, int fd);
+int uv__numa_cpu_nodes(int* cpu_node, size_t ncpus);
+#else
+UV_UNUSED(static void uv__socket_busy_poll(uv_loop_t* loop, int fd)) {
+  (void) loop;
+  (void) fd;
+}
 #endif
 
 typedef int (*uv__peersockfunc)(int, struct sockaddr*, socklen_t*);
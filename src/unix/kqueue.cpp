@@ -208,6 +208,8 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
       spec.tv_nsec = (timeout % 1000) * 1000000;
     }
 
+    uv__metrics_phase(loop, UV_METRICS_PHASE_POLL);
+
     if (pset != nullptr)
       pthread_sigmask(SIG_BLOCK, pset, nullptr);
 
@@ -225,7 +227,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
      * timeout == 0 (i.e. non-blocking poll) but there is no guarantee that the
      * operating system didn't reschedule our process while in the syscall.
      */
-    SAVE_ERRNO(uv__update_time(loop));
+    SAVE_ERRNO(uv__metrics_poll_wakeup(loop, nfds));
 
     if (nfds == 0) {
       assert(timeout != -1);
@@ -39,8 +39,10 @@
 #include <sys/param.h>
 #include <sys/prctl.h>
 #include <sys/sysinfo.h>
+#include <sys/timerfd.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <dirent.h>
 #include <time.h>
 #include "../utils/allocator.cpp"
 #define HAVE_IFADDRS_H 1
@@ -75,12 +77,22 @@
 # define CLOCK_BOOTTIME 7
 #endif
 
+/* Available from 3.11 and 5.11 onwards respectively. */
+#ifndef SO_BUSY_POLL
+# define SO_BUSY_POLL 46
+#endif
+
+#ifndef SO_PREFER_BUSY_POLL
+# define SO_PREFER_BUSY_POLL 69
+#endif
+
 static int read_models(unsigned int numcpus, uv_cpu_info_t* ci);
 static int read_times(FILE* statfile_fp,
                       unsigned int numcpus,
                       uv_cpu_info_t* ci);
 static void read_speeds(unsigned int numcpus, uv_cpu_info_t* ci);
 static uint64_t read_cpufreq(unsigned int cpunum);
+static void uv__hrtimer_io(uv_loop_t* loop, uv__io_t* w, unsigned int events);
 
 
 int uv__platform_loop_init(uv_loop_t* loop) {
@@ -110,6 +122,12 @@ int uv__platform_loop_init(uv_loop_t* loop) {
   loop->backend_fd = fd;
   loop->inotify_fd = -1;
   loop->inotify_watchers = nullptr;
+  loop->iou_ring = nullptr;
+  loop->busy_poll = 0;
+  loop->socket_busy_poll = 0;
+  loop->busy_poll_time = 0;
+  uv__io_init(&loop->hrtimer_watcher, uv__hrtimer_io, -1);
+  loop->hrtimer_due = 0;
 
   if (fd == -1)
     return UV__ERR(errno);
@@ -119,10 +137,18 @@ int uv__platform_loop_init(uv_loop_t* loop) {
 
 
 int uv__io_fork(uv_loop_t* loop) {
+  unsigned int socket_busy_poll;
+  unsigned int busy_poll;
+  uint64_t hrtimer_due;
   int err;
+  int use_iou;
   void* old_watchers;
 
   old_watchers = loop->inotify_watchers;
+  use_iou = (loop->iou_ring != nullptr);
+  busy_poll = loop->busy_poll;
+  socket_busy_poll = loop->socket_busy_poll;
+  hrtimer_due = loop->hrtimer_due;
 
   uv__close(loop->backend_fd);
   loop->backend_fd = -1;
@@ -132,11 +158,31 @@ int uv__io_fork(uv_loop_t* loop) {
   if (err)
     return err;
 
+  loop->busy_poll = busy_poll;
+  loop->socket_busy_poll = socket_busy_poll;
+  uv__hrtimer_arm(loop, hrtimer_due);
+
+  /* The rings are shared with the parent process, set up new ones. */
+  if (use_iou) {
+    err = uv__iou_init(loop);
+    if (err)
+      return err;
+  }
+
   return uv__inotify_fork(loop, old_watchers);
 }
 
 
 void uv__platform_loop_delete(uv_loop_t* loop) {
+  uv__iou_delete(loop);
+
+  if (loop->hrtimer_watcher.fd != -1) {
+    uv__io_stop(loop, &loop->hrtimer_watcher, POLLIN);
+    uv__close(loop->hrtimer_watcher.fd);
+    loop->hrtimer_watcher.fd = -1;
+    loop->hrtimer_due = 0;
+  }
+
   if (loop->inotify_fd == -1) return;
   uv__io_stop(loop, &loop->inotify_read_watcher, POLLIN);
   uv__close(loop->inotify_fd);
@@ -153,6 +199,11 @@ void uv__platform_invalidate_fd(uv_loop_t* loop, int fd) {
   assert(loop->watchers != nullptr);
   assert(fd >= 0);
 
+  if (loop->iou_ring != nullptr) {
+    uv__iou_invalidate_fd(loop, fd);
+    return;
+  }
+
   events = (struct epoll_event*) loop->watchers[loop->nwatchers];
   nfds = (uintptr_t) loop->watchers[loop->nwatchers + 1];
   if (events != nullptr)
@@ -177,6 +228,73 @@ void uv__platform_invalidate_fd(uv_loop_t* loop, int fd) {
 }
 
 
+void uv__socket_busy_poll(uv_loop_t* loop, int fd) {
+  int on;
+
+  if (loop->socket_busy_poll == 0)
+    return;
+
+  /* Best effort, raising SO_BUSY_POLL above net.core.busy_read requires
+   * CAP_NET_ADMIN and SO_PREFER_BUSY_POLL needs Linux 5.11.
+   */
+  on = 1;
+  setsockopt(fd,
+             SOL_SOCKET,
+             SO_BUSY_POLL,
+             &loop->socket_busy_poll,
+             sizeof(loop->socket_busy_poll));
+  setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &on, sizeof(on));
+}
+
+
+static void uv__hrtimer_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
+  uint64_t expirations;
+
+  /* Only drains the counter, the heap knows what's due. EAGAIN means the
+   * timer was rearmed after it fired, that's fine too.
+   */
+  read(w->fd, &expirations, sizeof(expirations));
+
+  loop->hrtimer_due = 0;
+  uv__run_hrtimers(loop);
+}
+
+
+/* Nanosecond timers wake up the loop through a timerfd in the poll set, so
+ * they work the same with every backend. CLOCK_MONOTONIC is the clock that
+ * uv_hrtime() reads. Without a timerfd they fall back to the poll timeout.
+ */
+void uv__hrtimer_arm(uv_loop_t* loop, uint64_t due) {
+  struct itimerspec spec;
+  int fd;
+
+  if (due == loop->hrtimer_due)
+    return;
+
+  fd = loop->hrtimer_watcher.fd;
+  if (fd == -1) {
+    fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (fd == -1)
+      return;
+
+    loop->hrtimer_watcher.fd = fd;
+  }
+
+  /* A zero it_value disarms the timer. */
+  memset(&spec, 0, sizeof(spec));
+  spec.it_value.tv_sec = due / 1000000000;
+  spec.it_value.tv_nsec = due % 1000000000;
+  if (timerfd_settime(fd, TFD_TIMER_ABSTIME, &spec, nullptr))
+    return;
+
+  loop->hrtimer_due = due;
+  if (due == 0)
+    uv__io_stop(loop, &loop->hrtimer_watcher, POLLIN);
+  else
+    uv__io_start(loop, &loop->hrtimer_watcher, POLLIN);
+}
+
+
 int uv__io_check_fd(uv_loop_t* loop, int fd) {
   struct epoll_event e;
   int rc;
@@ -218,8 +336,11 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   uv__io_t* w;
   sigset_t sigset;
   uint64_t sigmask;
+  uint64_t spin_start;
   uint64_t base;
+  uint64_t now;
   int have_signals;
+  int poll_timeout;
   int nevents;
   int count;
   int nfds;
@@ -227,6 +348,11 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   int op;
   int i;
 
+  if (loop->iou_ring != nullptr) {
+    uv__iou_poll(loop, timeout);
+    return;
+  }
+
   if (loop->nfds == 0) {
     assert(QUEUE_EMPTY(&loop->watcher_queue));
     return;
@@ -247,14 +373,23 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     e.events = w->pevents;
     e.data.fd = w->fd;
 
+    /* w->events is the interest set that the kernel knows about.  When the
+     * watcher only stopped watching some events, leave the kernel alone and
+     * squelch the extra events after epoll_wait().  A watcher that goes from
+     * POLLIN|POLLOUT to POLLIN and back within one loop iteration doesn't
+     * cost a system call that way.
+     *
+     * Edge-triggered watchers are always updated: EPOLL_CTL_MOD makes the
+     * kernel re-check the file descriptor, the edge may have been missed
+     * while the watcher wasn't watching.
+     */
     if (w->events == 0)
       op = EPOLL_CTL_ADD;
-    else
+    else if ((w->pevents & ~w->events) != 0 || (w->pevents & UV__POLLET))
       op = EPOLL_CTL_MOD;
+    else
+      continue;
 
-    /* XXX Future optimization: do EPOLL_CTL_MOD lazily if we stop watching
-     * events, skip the syscall and squelch the events after epoll_wait().
-     */
     if (epoll_ctl(loop->backend_fd, op, w->fd, &e)) {
       if (errno != EEXIST)
         abort();
@@ -281,6 +416,11 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   count = 48; /* Benchmarks suggest this gives the best throughput. */
   real_timeout = timeout;
 
+  /* Busy poll: don't go to sleep until the spin budget is used up. */
+  spin_start = 0;
+  if (timeout != 0 && loop->busy_poll != 0)
+    spin_start = uv__hrtime(UV_CLOCK_PRECISE);
+
   for (;;) {
     /* See the comment for max_safe_timeout for an explanation of why
      * this is necessary.  Executive summary: kernel bug workaround.
@@ -288,6 +428,12 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     if (sizeof(int32_t) == sizeof(long) && timeout >= max_safe_timeout)
       timeout = max_safe_timeout;
 
+    poll_timeout = timeout;
+    if (spin_start != 0)
+      poll_timeout = 0;
+
+    uv__metrics_phase(loop, UV_METRICS_PHASE_POLL);
+
     if (sigmask != 0 && no_epoll_pwait != 0)
       if (pthread_sigmask(SIG_BLOCK, &sigset, nullptr))
         abort();
@@ -300,7 +446,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
       nfds = epoll_pwait(loop->backend_fd,
                          events,
                          ARRAY_SIZE(events),
-                         timeout,
+                         poll_timeout,
                          &sigset);
 #endif
       if (nfds == -1 && errno == ENOSYS)
@@ -309,7 +455,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
       nfds = epoll_wait(loop->backend_fd,
                         events,
                         ARRAY_SIZE(events),
-                        timeout);
+                        poll_timeout);
       if (nfds == -1 && errno == ENOSYS)
         no_epoll_wait = 1;
     }
@@ -322,7 +468,27 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
      * timeout == 0 (i.e. non-blocking poll) but there is no guarantee that the
      * operating system didn't reschedule our process while in the syscall.
      */
-    SAVE_ERRNO(uv__update_time(loop));
+    SAVE_ERRNO(uv__metrics_poll_wakeup(loop, nfds));
+
+    if (spin_start != 0) {
+      SAVE_ERRNO(now = uv__hrtime(UV_CLOCK_PRECISE));
+
+      if (nfds != 0 ||
+          now - spin_start >= loop->busy_poll * (uint64_t) 1000) {
+        loop->busy_poll_time += now - spin_start;
+        spin_start = 0;
+      }
+
+      if (nfds == 0) {
+        /* Nothing yet, spin some more or block for what's left of the
+         * timeout.
+         */
+        if (timeout == -1)
+          continue;
+
+        goto update_timeout;
+      }
+    }
 
     if (nfds == 0) {
       assert(timeout != -1);
@@ -395,6 +561,19 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
         continue;
       }
 
+      /* The kernel reports events that the watcher stopped watching, narrow
+       * the interest set now so they don't keep waking up the event loop.
+       */
+      if ((pe->events & w->events & ~w->pevents) != 0) {
+        e.events = w->pevents;
+        e.data.fd = fd;
+
+        if (epoll_ctl(loop->backend_fd, EPOLL_CTL_MOD, fd, &e))
+          abort();
+
+        w->events = w->pevents;
+      }
+
       /* Give users only events they're interested in. Prevents spurious
        * callbacks when previous callback invocation in this loop has stopped
        * the current watcher. Also, filters out events that users has not
@@ -463,10 +642,14 @@ update_timeout:
 
     real_timeout -= (loop->time - base);
     if (real_timeout <= 0)
-      return;
+      break;
 
     timeout = real_timeout;
   }
+
+  /* The timeout expired while spinning. */
+  if (spin_start != 0)
+    loop->busy_poll_time += uv__hrtime(UV_CLOCK_PRECISE) - spin_start;
 }
 
 
@@ -859,6 +1042,69 @@ static uint64_t read_cpufreq(unsigned int cpunum) {
 }
 
 
+/* Sets `cpu_node[cpu]` to the NUMA node of every CPU below `ncpus` that has
+ * one, and leaves the others alone. Returns the number of nodes with CPUs.
+ */
+int uv__numa_cpu_nodes(int* cpu_node, size_t ncpus) {
+  struct dirent* ent;
+  unsigned int node;
+  unsigned int first;
+  unsigned int last;
+  char buf[1024];
+  int nnodes;
+  int found;
+  DIR* dir;
+  FILE* fp;
+  char sep;
+
+  dir = opendir("/sys/devices/system/node");
+  if (dir == nullptr)
+    return UV__ERR(errno);
+
+  nnodes = 0;
+  while ((ent = readdir(dir)) != nullptr) {
+    if (sscanf(ent->d_name, "node%u", &node) != 1)
+      continue;
+
+    snprintf(buf,
+             sizeof(buf),
+             "/sys/devices/system/node/node%u/cpulist",
+             node);
+
+    fp = uv__open_file(buf);
+    if (fp == nullptr)
+      continue;
+
+    /* A list of ranges like "0-3,8-11". */
+    found = 0;
+    while (fscanf(fp, "%u", &first) == 1) {
+      last = first;
+      sep = fgetc(fp);
+      if (sep == '-') {
+        if (fscanf(fp, "%u", &last) != 1)
+          break;
+        sep = fgetc(fp);
+      }
+
+      for (; first <= last && first < ncpus; first++) {
+        cpu_node[first] = node;
+        found = 1;
+      }
+
+      if (sep != ',')
+        break;
+    }
+
+    fclose(fp);
+    nnodes += found;
+  }
+
+  closedir(dir);
+
+  return nnodes;
+}
+
+
 static int uv__ifaddr_exclude(struct ifaddrs *ent, int exclude_type) {
   if (!((ent->ifa_flags & IFF_UP) && (ent->ifa_flags & IFF_RUNNING)))
     return 1;
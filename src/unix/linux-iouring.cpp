@@ -0,0 +1,587 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* io_uring polling backend.
+ *
+ * Instead of one epoll_ctl() per watcher change followed by epoll_wait(),
+ * watchers are armed with one-shot IORING_OP_POLL_ADD requests that are put
+ * on the submission ring and handed to the kernel by the same io_uring_enter()
+ * call that waits for completions.  A loop iteration therefore costs a single
+ * system call no matter how many watchers were started or stopped.
+ *
+ * A completion disarms the file descriptor; the watcher is put back on the
+ * watcher queue and re-armed on the next submission, which gives the same
+ * level-triggered semantics as the epoll backend.
+ */
+
+#include "uv.h"
+#include "internal.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "../utils/allocator.cpp"
+
+/* Also sizes the completion ring, which the kernel makes twice as large. */
+#define UV__IOU_ENTRIES 512
+
+/* user_data of requests whose completion we don't care about. */
+#define UV__IOU_IGNORE ((uint64_t) -1)
+
+struct uv__iou_fd {
+  uint16_t armed;  /* Events of the in-flight poll request or 0. */
+  uint16_t gen;    /* Bumped when the in-flight poll request is cancelled. */
+};
+
+struct uv__iou {
+  int ringfd;
+  uint32_t sqmask;
+  uint32_t sqentries;
+  uint32_t sqtail;
+  uint32_t cqmask;
+  uint32_t* sqhead_ptr;
+  uint32_t* sqtail_ptr;
+  uint32_t* sqarray;
+  uint32_t* cqhead_ptr;
+  uint32_t* cqtail_ptr;
+  struct uv__io_uring_sqe* sqes;
+  struct uv__io_uring_cqe* cqes;
+  void* ring;
+  size_t ringlen;
+  size_t sqeslen;
+  struct uv__iou_fd* fds;
+  unsigned int nfds;
+};
+
+
+static uint64_t uv__iou_user_data(int fd, uint16_t gen) {
+  return ((uint64_t) gen << 32) | (uint32_t) fd;
+}
+
+
+static uint32_t uv__iou_pending(struct uv__iou* iou) {
+  return iou->sqtail - __atomic_load_n(iou->sqhead_ptr, __ATOMIC_ACQUIRE);
+}
+
+
+static void uv__iou_submit(struct uv__iou* iou) {
+  __atomic_store_n(iou->sqtail_ptr, iou->sqtail, __ATOMIC_RELEASE);
+
+  while (uv__iou_pending(iou) != 0) {
+    if (uv__io_uring_enter(iou->ringfd,
+                           uv__iou_pending(iou),
+                           0,
+                           0,
+                           nullptr,
+                           0) != -1)
+      continue;
+
+    if (errno == EINTR)
+      continue;
+
+    /* The completion ring overflowed; the requests are picked up by the next
+     * io_uring_enter() call in uv__iou_poll().
+     */
+    if (errno == EBUSY || errno == EAGAIN)
+      return;
+
+    abort();
+  }
+}
+
+
+static struct uv__io_uring_sqe* uv__iou_get_sqe(struct uv__iou* iou) {
+  struct uv__io_uring_sqe* sqe;
+  uint32_t slot;
+
+  if (uv__iou_pending(iou) == iou->sqentries)
+    uv__iou_submit(iou);
+
+  /* Still full, only happens when the completion ring overflowed. */
+  if (uv__iou_pending(iou) == iou->sqentries)
+    abort();
+
+  slot = iou->sqtail & iou->sqmask;
+  iou->sqarray[slot] = slot;
+  iou->sqtail++;
+
+  sqe = iou->sqes + slot;
+  memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+
+static struct uv__iou_fd* uv__iou_get_fd(uv_loop_t* loop,
+                                         struct uv__iou* iou,
+                                         int fd) {
+  unsigned int nfds;
+
+  assert(fd >= 0);
+  assert((unsigned) fd < loop->nwatchers);
+
+  if ((unsigned) fd >= iou->nfds) {
+    nfds = loop->nwatchers;
+    auto* fds = static_cast<struct uv__iou_fd*>(
+        uv__reallocf(iou->fds, nfds * sizeof(iou->fds[0])));
+    if (fds == nullptr)
+      abort();
+
+    memset(fds + iou->nfds, 0, (nfds - iou->nfds) * sizeof(fds[0]));
+    iou->fds = fds;
+    iou->nfds = nfds;
+  }
+
+  return iou->fds + fd;
+}
+
+
+static void uv__iou_cancel(struct uv__iou* iou, int fd, struct uv__iou_fd* e) {
+  struct uv__io_uring_sqe* sqe;
+
+  sqe = uv__iou_get_sqe(iou);
+  sqe->opcode = UV__IORING_OP_POLL_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = uv__iou_user_data(fd, e->gen);
+  sqe->user_data = UV__IOU_IGNORE;
+
+  /* The completion of the cancelled request, if any, is now stale. */
+  e->armed = 0;
+  e->gen++;
+}
+
+
+static void uv__iou_arm(uv_loop_t* loop, struct uv__iou* iou, uv__io_t* w) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou_fd* e;
+  unsigned int pevents;
+
+  e = uv__iou_get_fd(loop, iou, w->fd);
+
+  /* Poll requests are one-shot, edge-triggered watchers need no special
+   * treatment.
+   */
+  pevents = w->pevents & ~UV__POLLET;
+
+  if (e->armed != 0) {
+    /* Narrowing the interest set doesn't need a new request, the extra
+     * events are filtered out in uv__iou_poll().
+     */
+    if ((pevents & ~e->armed) == 0) {
+      w->events = e->armed | (w->pevents & UV__POLLET);
+      return;
+    }
+
+    uv__iou_cancel(iou, w->fd, e);
+  }
+
+  sqe = uv__iou_get_sqe(iou);
+  sqe->opcode = UV__IORING_OP_POLL_ADD;
+  sqe->fd = w->fd;
+  sqe->poll32_events = pevents;
+  sqe->user_data = uv__iou_user_data(w->fd, e->gen);
+
+  e->armed = pevents;
+  w->events = w->pevents;
+}
+
+
+static void uv__iou_free(struct uv__iou* iou) {
+  if (iou->sqes != MAP_FAILED)
+    munmap(iou->sqes, iou->sqeslen);
+
+  if (iou->ring != MAP_FAILED)
+    munmap(iou->ring, iou->ringlen);
+
+  uv__close(iou->ringfd);
+  uv__free(iou->fds);
+  uv__free(iou);
+}
+
+
+int uv__iou_init(uv_loop_t* loop) {
+  struct uv__io_uring_params params;
+  struct epoll_event e;
+  struct uv__iou* iou;
+  unsigned int features;
+  unsigned int i;
+  size_t sqlen;
+  size_t cqlen;
+  char* ring;
+  uv__io_t* w;
+  int ringfd;
+  int err;
+
+  if (loop->iou_ring != nullptr)
+    return 0;
+
+  memset(&params, 0, sizeof(params));
+  ringfd = uv__io_uring_setup(UV__IOU_ENTRIES, &params);
+
+  if (ringfd == -1) {
+    /* Not compiled in, disabled by the administrator or filtered by seccomp.
+     * The loop keeps using epoll.
+     */
+    if (errno == ENOSYS || errno == EPERM || errno == EINVAL)
+      return UV_ENOSYS;
+    return UV__ERR(errno);
+  }
+
+  /* IORING_FEAT_EXT_ARG is the newest of the three (Linux 5.11), it's what
+   * lets us wait with a timeout and signal mask without a timeout request.
+   */
+  features = UV__IORING_FEAT_SINGLE_MMAP |
+             UV__IORING_FEAT_NODROP |
+             UV__IORING_FEAT_EXT_ARG;
+
+  if ((params.features & features) != features) {
+    uv__close(ringfd);
+    return UV_ENOSYS;
+  }
+
+  iou = create_ptrstruct<uv__iou>(sizeof(*iou));
+  if (iou == nullptr) {
+    uv__close(ringfd);
+    return UV_ENOMEM;
+  }
+
+  sqlen = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cqlen = params.cq_off.cqes +
+          params.cq_entries * sizeof(struct uv__io_uring_cqe);
+
+  iou->ringfd = ringfd;
+  iou->ringlen = sqlen > cqlen ? sqlen : cqlen;
+  iou->sqeslen = params.sq_entries * sizeof(struct uv__io_uring_sqe);
+  iou->ring = mmap(nullptr,
+                   iou->ringlen,
+                   PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE,
+                   ringfd,
+                   UV__IORING_OFF_SQ_RING);
+  iou->sqes = static_cast<struct uv__io_uring_sqe*>(
+      mmap(nullptr,
+           iou->sqeslen,
+           PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_POPULATE,
+           ringfd,
+           UV__IORING_OFF_SQES));
+
+  if (iou->ring == MAP_FAILED || iou->sqes == MAP_FAILED) {
+    uv__iou_free(iou);
+    return UV_ENOMEM;
+  }
+
+  ring = static_cast<char*>(iou->ring);
+  iou->sqhead_ptr = reinterpret_cast<uint32_t*>(ring + params.sq_off.head);
+  iou->sqtail_ptr = reinterpret_cast<uint32_t*>(ring + params.sq_off.tail);
+  iou->sqarray = reinterpret_cast<uint32_t*>(ring + params.sq_off.array);
+  iou->sqmask = *reinterpret_cast<uint32_t*>(ring + params.sq_off.ring_mask);
+  iou->sqentries = params.sq_entries;
+  iou->sqtail = *iou->sqtail_ptr;
+  iou->cqhead_ptr = reinterpret_cast<uint32_t*>(ring + params.cq_off.head);
+  iou->cqtail_ptr = reinterpret_cast<uint32_t*>(ring + params.cq_off.tail);
+  iou->cqmask = *reinterpret_cast<uint32_t*>(ring + params.cq_off.ring_mask);
+  iou->cqes =
+      reinterpret_cast<struct uv__io_uring_cqe*>(ring + params.cq_off.cqes);
+  iou->fds = nullptr;
+  iou->nfds = 0;
+
+  memset(&e, 0, sizeof(e));
+  e.events = POLLIN;
+  e.data.fd = ringfd;
+
+  if (epoll_ctl(loop->backend_fd, EPOLL_CTL_ADD, ringfd, &e)) {
+    err = UV__ERR(errno);
+    uv__iou_free(iou);
+    return err;
+  }
+
+  loop->iou_ring = iou;
+
+  /* Watchers that were registered with epoll before the switch need to be
+   * armed again.  Their epoll registrations are dropped so that the backend
+   * fd only becomes readable when the completion ring has entries, that keeps
+   * uv_backend_fd() usable for embedders.
+   */
+  for (i = 0; i < loop->nwatchers; i++) {
+    w = loop->watchers[i];
+    if (w == nullptr || w->pevents == 0)
+      continue;
+
+    if (w->events != 0)
+      epoll_ctl(loop->backend_fd, EPOLL_CTL_DEL, w->fd, &e);
+
+    w->events = 0;
+    if (QUEUE_EMPTY(&w->watcher_queue))
+      QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
+  }
+
+  return 0;
+}
+
+
+void uv__iou_delete(uv_loop_t* loop) {
+  if (loop->iou_ring == nullptr)
+    return;
+
+  uv__iou_free(static_cast<struct uv__iou*>(loop->iou_ring));
+  loop->iou_ring = nullptr;
+}
+
+
+void uv__iou_invalidate_fd(uv_loop_t* loop, int fd) {
+  struct uv__iou* iou;
+  struct uv__iou_fd* e;
+
+  iou = static_cast<struct uv__iou*>(loop->iou_ring);
+  if ((unsigned) fd >= iou->nfds)
+    return;
+
+  e = iou->fds + fd;
+  if (e->armed == 0)
+    return;
+
+  /* A poll request holds a reference to the file, cancel it right away so
+   * that closing the file descriptor actually releases the file.
+   */
+  uv__iou_cancel(iou, fd, e);
+  uv__iou_submit(iou);
+}
+
+
+void uv__iou_poll(uv_loop_t* loop, int timeout) {
+  struct uv__io_uring_getevents_arg arg;
+  struct uv__io_uring_cqe cqes[1024];
+  struct uv__io_uring_cqe* cqe;
+  struct uv__iou_fd* e;
+  struct uv__iou* iou;
+  struct uv__io_uring_timespec ts;
+  unsigned int events;
+  uint32_t head;
+  uint32_t tail;
+  QUEUE* q;
+  uv__io_t* w;
+  sigset_t sigset;
+  uint64_t spin_start;
+  uint64_t base;
+  uint64_t now;
+  int have_signals;
+  int poll_timeout;
+  int real_timeout;
+  int nevents;
+  int count;
+  int ncqes;
+  int rc;
+  int fd;
+  int i;
+
+  if (loop->nfds == 0) {
+    assert(QUEUE_EMPTY(&loop->watcher_queue));
+    return;
+  }
+
+  iou = static_cast<struct uv__iou*>(loop->iou_ring);
+
+  memset(&arg, 0, sizeof(arg));
+  if (loop->flags & UV_LOOP_BLOCK_SIGPROF) {
+    sigemptyset(&sigset);
+    sigaddset(&sigset, SIGPROF);
+    arg.sigmask = (uint64_t) (uintptr_t) &sigset;
+    arg.sigmask_sz = _NSIG / 8;
+  }
+
+  assert(timeout >= -1);
+  base = loop->time;
+  count = 48; /* Benchmarks suggest this gives the best throughput. */
+  real_timeout = timeout;
+
+  /* Busy poll: don't go to sleep until the spin budget is used up. */
+  spin_start = 0;
+  if (timeout != 0 && loop->busy_poll != 0)
+    spin_start = uv__hrtime(UV_CLOCK_PRECISE);
+
+  for (;;) {
+    while (!QUEUE_EMPTY(&loop->watcher_queue)) {
+      q = QUEUE_HEAD(&loop->watcher_queue);
+      QUEUE_REMOVE(q);
+      QUEUE_INIT(q);
+
+      w = QUEUE_DATA(q, uv__io_t, watcher_queue);
+      assert(w->pevents != 0);
+      assert(w->fd >= 0);
+      assert(w->fd < (int) loop->nwatchers);
+
+      uv__iou_arm(loop, iou, w);
+    }
+
+    poll_timeout = timeout;
+    if (spin_start != 0)
+      poll_timeout = 0;
+
+    arg.ts = 0;
+    if (poll_timeout != -1) {
+      ts.tv_sec = poll_timeout / 1000;
+      ts.tv_nsec = (poll_timeout % 1000) * 1000000;
+      arg.ts = (uint64_t) (uintptr_t) &ts;
+    }
+
+    uv__metrics_phase(loop, UV_METRICS_PHASE_POLL);
+
+    /* Submit the queued requests and wait for completions in one go. */
+    __atomic_store_n(iou->sqtail_ptr, iou->sqtail, __ATOMIC_RELEASE);
+    rc = uv__io_uring_enter(iou->ringfd,
+                            uv__iou_pending(iou),
+                            poll_timeout == 0 ? 0 : 1,
+                            UV__IORING_ENTER_GETEVENTS |
+                                UV__IORING_ENTER_EXT_ARG,
+                            &arg,
+                            sizeof(arg));
+
+    if (rc == -1 &&
+        errno != EINTR &&
+        errno != ETIME &&
+        errno != EBUSY &&
+        errno != EAGAIN) {
+      abort();
+    }
+
+    /* Copy the completions out so the ring has room for the requests that
+     * the callbacks below queue up.
+     */
+    head = *iou->cqhead_ptr;
+    tail = __atomic_load_n(iou->cqtail_ptr, __ATOMIC_ACQUIRE);
+    for (ncqes = 0; head != tail && ncqes < (int) ARRAY_SIZE(cqes); ncqes++)
+      cqes[ncqes] = iou->cqes[head++ & iou->cqmask];
+    __atomic_store_n(iou->cqhead_ptr, head, __ATOMIC_RELEASE);
+
+    /* Update loop->time unconditionally. It's tempting to skip the update when
+     * timeout == 0 (i.e. non-blocking poll) but there is no guarantee that the
+     * operating system didn't reschedule our process while in the syscall.
+     */
+    SAVE_ERRNO(uv__metrics_poll_wakeup(loop, ncqes));
+
+    have_signals = 0;
+    nevents = 0;
+
+    for (i = 0; i < ncqes; i++) {
+      cqe = cqes + i;
+
+      if (cqe->user_data == UV__IOU_IGNORE)
+        continue;
+
+      fd = (int) (uint32_t) cqe->user_data;
+      assert(fd >= 0);
+      assert((unsigned) fd < iou->nfds);
+
+      /* Skip completions of cancelled requests. */
+      e = iou->fds + fd;
+      if (e->armed == 0 || e->gen != (uint16_t) (cqe->user_data >> 32))
+        continue;
+
+      e->armed = 0;
+
+      w = loop->watchers[fd];
+      if (w == nullptr)
+        continue;  /* File descriptor that we've stopped watching. */
+
+      /* The request is spent, re-arm it on the next submission. The callback
+       * is free to stop the watcher, uv__io_stop() unlinks it again.
+       */
+      w->events = 0;
+      if (QUEUE_EMPTY(&w->watcher_queue))
+        QUEUE_INSERT_TAIL(&loop->watcher_queue, &w->watcher_queue);
+
+      if (cqe->res < 0)
+        events = POLLERR;
+      else
+        events = cqe->res;
+
+      /* Give users only events they're interested in, the request may have
+       * been armed with a wider interest set.
+       */
+      events &= w->pevents | POLLERR | POLLHUP;
+
+      /* See the comment about this quirk in the epoll backend. */
+      if (events == POLLERR || events == POLLHUP)
+        events |= w->pevents & (POLLIN | POLLOUT | UV__POLLRDHUP | UV__POLLPRI);
+
+      if (events != 0) {
+        /* Run signal watchers last.  This also affects child process watchers
+         * because those are implemented in terms of signal watchers.
+         */
+        if (w == &loop->signal_io_watcher)
+          have_signals = 1;
+        else
+          w->cb(loop, w, events);
+
+        nevents++;
+      }
+    }
+
+    if (spin_start != 0) {
+      now = uv__hrtime(UV_CLOCK_PRECISE);
+
+      if (nevents != 0 ||
+          now - spin_start >= loop->busy_poll * (uint64_t) 1000) {
+        loop->busy_poll_time += now - spin_start;
+        spin_start = 0;
+      }
+    }
+
+    if (have_signals != 0) {
+      loop->signal_io_watcher.cb(loop, &loop->signal_io_watcher, POLLIN);
+      return;  /* Event loop should cycle now so don't poll again. */
+    }
+
+    if (nevents != 0) {
+      if (ncqes == ARRAY_SIZE(cqes) && --count != 0) {
+        /* Poll for more events but don't block this time. */
+        timeout = 0;
+        continue;
+      }
+      return;
+    }
+
+    if (timeout == 0)
+      return;
+
+    if (timeout == -1)
+      continue;
+
+    assert(timeout > 0);
+
+    real_timeout -= (loop->time - base);
+    if (real_timeout <= 0)
+      break;
+
+    timeout = real_timeout;
+  }
+
+  /* The timeout expired while spinning. */
+  if (spin_start != 0)
+    loop->busy_poll_time += uv__hrtime(UV_CLOCK_PRECISE) - spin_start;
+}
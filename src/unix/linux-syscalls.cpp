@@ -126,6 +126,24 @@
 # endif
 #endif /* __NR_getrandom */
 
+#ifndef __NR_io_uring_setup
+# if defined(__arm__)
+#  define __NR_io_uring_setup (UV_SYSCALL_BASE + 425)
+# elif defined(__x86_64__) || defined(__i386__) || defined(__aarch64__) || \
+       defined(__ppc__) || defined(__s390__)
+#  define __NR_io_uring_setup 425
+# endif
+#endif /* __NR_io_uring_setup */
+
+#ifndef __NR_io_uring_enter
+# if defined(__arm__)
+#  define __NR_io_uring_enter (UV_SYSCALL_BASE + 426)
+# elif defined(__x86_64__) || defined(__i386__) || defined(__aarch64__) || \
+       defined(__ppc__) || defined(__s390__)
+#  define __NR_io_uring_enter 426
+# endif
+#endif /* __NR_io_uring_enter */
+
 struct uv__mmsghdr;
 
 int uv__sendmmsg(int fd,
@@ -203,3 +221,32 @@ ssize_t uv__getrandom(void* buf, size_t buflen, unsigned flags) {
   return errno = ENOSYS, -1;
 #endif
 }
+
+
+int uv__io_uring_setup(unsigned int entries, struct uv__io_uring_params* params) {
+#if defined(__NR_io_uring_setup)
+  return syscall(__NR_io_uring_setup, entries, params);
+#else
+  return errno = ENOSYS, -1;
+#endif
+}
+
+
+int uv__io_uring_enter(int fd,
+                       unsigned int to_submit,
+                       unsigned int min_complete,
+                       unsigned int flags,
+                       const void* arg,
+                       size_t argsz) {
+#if defined(__NR_io_uring_enter)
+  return syscall(__NR_io_uring_enter,
+                 fd,
+                 to_submit,
+                 min_complete,
+                 flags,
+                 arg,
+                 argsz);
+#else
+  return errno = ENOSYS, -1;
+#endif
+}
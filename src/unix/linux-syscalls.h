@@ -61,6 +61,97 @@ struct uv__statx {
   uint64_t unused1[14];
 };
 
+/* io_uring ABI, mirrors <linux/io_uring.h> so we can build against old
+ * kernel headers.
+ */
+struct uv__io_sqring_offsets {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t flags;
+  uint32_t dropped;
+  uint32_t array;
+  uint32_t reserved0;
+  uint64_t reserved1;
+};
+
+struct uv__io_cqring_offsets {
+  uint32_t head;
+  uint32_t tail;
+  uint32_t ring_mask;
+  uint32_t ring_entries;
+  uint32_t overflow;
+  uint32_t cqes;
+  uint64_t reserved0;
+  uint64_t reserved1;
+};
+
+struct uv__io_uring_params {
+  uint32_t sq_entries;
+  uint32_t cq_entries;
+  uint32_t flags;
+  uint32_t sq_thread_cpu;
+  uint32_t sq_thread_idle;
+  uint32_t features;
+  uint32_t wq_fd;
+  uint32_t reserved[3];
+  struct uv__io_sqring_offsets sq_off;
+  struct uv__io_cqring_offsets cq_off;
+};
+
+struct uv__io_uring_sqe {
+  uint8_t opcode;
+  uint8_t flags;
+  uint16_t ioprio;
+  int32_t fd;
+  uint64_t off;
+  uint64_t addr;
+  uint32_t len;
+  uint32_t poll32_events;
+  uint64_t user_data;
+  uint64_t pad[3];
+};
+
+struct uv__io_uring_cqe {
+  uint64_t user_data;
+  int32_t res;
+  uint32_t flags;
+};
+
+struct uv__io_uring_timespec {
+  int64_t tv_sec;
+  int64_t tv_nsec;
+};
+
+struct uv__io_uring_getevents_arg {
+  uint64_t sigmask;
+  uint32_t sigmask_sz;
+  uint32_t pad;
+  uint64_t ts;
+};
+
+enum {
+  UV__IORING_OP_POLL_ADD = 6,
+  UV__IORING_OP_POLL_REMOVE = 7
+};
+
+enum {
+  UV__IORING_ENTER_GETEVENTS = 1u << 0,
+  UV__IORING_ENTER_EXT_ARG = 1u << 3
+};
+
+enum {
+  UV__IORING_FEAT_SINGLE_MMAP = 1u << 0,
+  UV__IORING_FEAT_NODROP = 1u << 1,
+  UV__IORING_FEAT_EXT_ARG = 1u << 8
+};
+
+enum {
+  UV__IORING_OFF_SQ_RING = 0,
+  UV__IORING_OFF_SQES = 0x10000000
+};
+
 ssize_t uv__preadv(int fd, const struct iovec *iov, int iovcnt, int64_t offset);
 ssize_t uv__pwritev(int fd, const struct iovec *iov, int iovcnt, int64_t offset);
 int uv__dup3(int oldfd, int newfd, int flags);
@@ -70,5 +161,12 @@ int uv__statx(int dirfd,
               unsigned int mask,
               struct uv__statx* statxbuf);
 ssize_t uv__getrandom(void* buf, size_t buflen, unsigned flags);
+int uv__io_uring_setup(unsigned int entries, struct uv__io_uring_params* params);
+int uv__io_uring_enter(int fd,
+                       unsigned int to_submit,
+                       unsigned int min_complete,
+                       unsigned int flags,
+                       const void* arg,
+                       size_t argsz);
 
 #endif /* UV_LINUX_SYSCALL_H_ */
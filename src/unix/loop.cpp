@@ -37,7 +37,8 @@ int uv_loop_init(uv_loop_t* loop) {
   loop->data = saved_data;
 
   heap_init((struct heap*) &loop->timer_heap);
-  QUEUE_INIT(&loop->wq);
+  heap_init((struct heap*) &loop->hrtimer_heap);
+  loop->wq = nullptr;
   QUEUE_INIT(&loop->idle_handles);
   QUEUE_INIT(&loop->async_handles);
   QUEUE_INIT(&loop->check_handles);
@@ -56,6 +57,8 @@ int uv_loop_init(uv_loop_t* loop) {
   uv__update_time(loop);
   loop->async_io_watcher.fd = -1;
   loop->async_wfd = -1;
+  loop->async_pending = nullptr;
+  QUEUE_INIT(&loop->async_ready);
   loop->signal_pipefd[0] = -1;
   loop->signal_pipefd[1] = -1;
   loop->backend_fd = -1;
@@ -81,10 +84,6 @@ int uv_loop_init(uv_loop_t* loop) {
   if (err)
     goto fail_rwlock_init;
 
-  err = uv_mutex_init(&loop->wq_mutex);
-  if (err)
-    goto fail_mutex_init;
-
   err = uv_async_init(loop, &loop->wq_async, uv__work_done);
   if (err)
     goto fail_async_init;
@@ -95,9 +94,6 @@ int uv_loop_init(uv_loop_t* loop) {
   return 0;
 
 fail_async_init:
-  uv_mutex_destroy(&loop->wq_mutex);
-
-fail_mutex_init:
   uv_rwlock_destroy(&loop->cloexec_lock);
 
 fail_rwlock_init:
@@ -147,6 +143,7 @@ void uv__loop_close(uv_loop_t* loop) {
   uv__signal_loop_cleanup(loop);
   uv__platform_loop_delete(loop);
   uv__async_stop(loop);
+  uv__read_pool_delete(loop);
 
   if (loop->emfile_fd != -1) {
     uv__close(loop->emfile_fd);
@@ -158,11 +155,8 @@ void uv__loop_close(uv_loop_t* loop) {
     loop->backend_fd = -1;
   }
 
-  uv_mutex_lock(&loop->wq_mutex);
-  assert(QUEUE_EMPTY(&loop->wq) && "thread pool work queue not empty!");
+  assert(loop->wq == nullptr && "thread pool work queue not empty!");
   assert(!uv__has_active_reqs(loop));
-  uv_mutex_unlock(&loop->wq_mutex);
-  uv_mutex_destroy(&loop->wq_mutex);
 
   /*
    * Note that all thread pool stuff is finished at this point and
@@ -179,10 +173,34 @@ void uv__loop_close(uv_loop_t* loop) {
   uv__free(loop->watchers);
   loop->watchers = nullptr;
   loop->nwatchers = 0;
+
+  heap_free((struct heap*) &loop->timer_heap);
+  heap_free((struct heap*) &loop->hrtimer_heap);
 }
 
 
 int uv__loop_configure(uv_loop_t* loop, uv_loop_option option, va_list ap) {
+  if (option == UV_LOOP_ENABLE_METRICS) {
+    loop->flags |= UV_LOOP_METRICS;
+    uv__metrics_start(loop);
+    return 0;
+  }
+
+#if defined(__linux__)
+  if (option == UV_LOOP_USE_IO_URING)
+    return uv__iou_init(loop);
+
+  if (option == UV_LOOP_BUSY_POLL) {
+    loop->busy_poll = va_arg(ap, unsigned int);
+    return 0;
+  }
+
+  if (option == UV_LOOP_SOCKET_BUSY_POLL) {
+    loop->socket_busy_poll = va_arg(ap, unsigned int);
+    return 0;
+  }
+#endif
+
   if (option != UV_LOOP_BLOCK_SIGNAL)
     return UV_ENOSYS;
 
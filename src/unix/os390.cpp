@@ -875,6 +875,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     if (sizeof(int32_t) == sizeof(long) && timeout >= max_safe_timeout)
       timeout = max_safe_timeout;
 
+    uv__metrics_phase(loop, UV_METRICS_PHASE_POLL);
     nfds = epoll_wait(loop->ep, events,
                       ARRAY_SIZE(events), timeout);
 
@@ -883,7 +884,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
      * operating system didn't reschedule our process while in the syscall.
      */
     base = loop->time;
-    SAVE_ERRNO(uv__update_time(loop));
+    SAVE_ERRNO(uv__metrics_poll_wakeup(loop, nfds));
     if (nfds == 0) {
       assert(timeout != -1);
 
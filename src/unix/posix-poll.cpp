@@ -182,6 +182,8 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
    * our caller then we need to loop around and poll() again.
    */
   for (;;) {
+    uv__metrics_phase(loop, UV_METRICS_PHASE_POLL);
+
     if (pset != nullptr)
       if (pthread_sigmask(SIG_BLOCK, pset, nullptr))
         abort();
@@ -194,7 +196,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
      * timeout == 0 (i.e. non-blocking poll) but there is no guarantee that the
      * operating system didn't reschedule our process while in the syscall.
      */
-    SAVE_ERRNO(uv__update_time(loop));
+    SAVE_ERRNO(uv__metrics_poll_wakeup(loop, nfds));
 
     if (nfds == 0) {
       assert(timeout != -1);
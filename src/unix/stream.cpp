@@ -35,6 +35,10 @@
 #include <unistd.h>
 #include <limits.h> /* IOV_MAX */
 #include "../utils/allocator.cpp"
+#if defined(UV__HAVE_ZEROCOPY)
+# include <netinet/in.h>
+# include <linux/errqueue.h>
+#endif
 #if defined(__APPLE__)
 # include <sys/event.h>
 # include <sys/time.h>
@@ -74,12 +78,19 @@ struct uv__stream_select_s {
     (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)
 #endif /* defined(__APPLE__) */
 
+/* The most buffers that a corked stream writes with one writev(). */
+#define UV__WRITE_GATHER_MAX 1024
+
+/* The most buffers that a uv_alloc_bufs_cb can fill in. */
+#define UV__READ_MAX_BUFS 16
+
 static void uv__stream_connect(uv_stream_t*);
 static void uv__write(uv_stream_t* stream);
 static void uv__read(uv_stream_t* stream);
 static void uv__stream_io(uv_loop_t* loop, uv__io_t* w, unsigned int events);
 static void uv__write_callbacks(uv_stream_t* stream);
 static size_t uv__write_req_size(uv_write_t* req);
+void uv_try_write_cb(uv_write_t* req, int status);
 
 
 void uv__stream_init(uv_loop_t* loop,
@@ -89,6 +100,8 @@ void uv__stream_init(uv_loop_t* loop,
   uv__handle_init(loop, reinterpret_cast<uv_handle_t*>(stream), type);
   stream->read_cb = nullptr;
   stream->alloc_cb = nullptr;
+  stream->read_bufs_cb = nullptr;
+  stream->alloc_bufs_cb = nullptr;
   stream->close_cb = nullptr;
   stream->connection_cb = nullptr;
   stream->connect_req = nullptr;
@@ -98,7 +111,12 @@ void uv__stream_init(uv_loop_t* loop,
   stream->delayed_error = 0;
   QUEUE_INIT(&stream->write_queue);
   QUEUE_INIT(&stream->write_completed_queue);
+  QUEUE_INIT(&stream->write_zerocopy_queue);
   stream->write_queue_size = 0;
+  stream->zerocopy_threshold = 0;
+  stream->zerocopy_next = 0;
+  stream->zerocopy_inflight = 0;
+  stream->cork_threshold = 0;
 
   if (loop->emfile_fd == -1) {
     auto err = uv__open_cloexec("/dev/null", O_RDONLY);
@@ -410,6 +428,11 @@ int uv__stream_open(uv_stream_t* stream, int fd, int flags) {
         uv__tcp_keepalive(fd, 1, 60)) {
       return UV__ERR(errno);
     }
+
+    if ((stream->flags & UV_HANDLE_TCP_ZEROCOPY) && uv__tcp_zerocopy(fd, 1))
+      return UV__ERR(errno);
+
+    uv__socket_busy_poll(stream->loop, fd);
   }
 
 #if defined(__APPLE__)
@@ -443,6 +466,9 @@ void uv__stream_flush_write_queue(uv_stream_t* stream, int error) {
 
 
 void uv__stream_destroy(uv_stream_t* stream) {
+  uv_write_t* req;
+  QUEUE* q;
+
   assert(!uv__io_active(&stream->io_watcher, POLLIN | POLLOUT));
   assert(stream->flags & UV_HANDLE_CLOSED);
 
@@ -452,6 +478,20 @@ void uv__stream_destroy(uv_stream_t* stream) {
     stream->connect_req = nullptr;
   }
 
+  /* Requests that wait for the kernel to release their data were queued
+   * before the ones that are still in the write queue.
+   */
+  while (!QUEUE_EMPTY(&stream->write_zerocopy_queue)) {
+    q = QUEUE_HEAD(&stream->write_zerocopy_queue);
+    QUEUE_REMOVE(q);
+
+    req = QUEUE_DATA(q, uv_write_t, queue);
+    if (req->error == 0 && req->zerocopy_sent != req->zerocopy_done)
+      req->error = UV_ECANCELED;
+
+    QUEUE_INSERT_TAIL(&stream->write_completed_queue, &req->queue);
+  }
+
   uv__stream_flush_write_queue(stream, UV_ECANCELED);
   uv__write_callbacks(stream);
 
@@ -671,10 +711,13 @@ static void uv__drain(uv_stream_t* stream) {
   uv__io_stop(stream->loop, &stream->io_watcher, POLLOUT);
   uv__stream_osx_interrupt_select(stream);
 
-  /* Shutdown? */
+  /* Shutdown? Not before the write callbacks that wait for zero-copy
+   * completions have been made.
+   */
   if ((stream->flags & UV_HANDLE_SHUTTING) &&
       !(stream->flags & UV_HANDLE_CLOSING) &&
-      !(stream->flags & UV_HANDLE_SHUT)) {
+      !(stream->flags & UV_HANDLE_SHUT) &&
+      QUEUE_EMPTY(&stream->write_zerocopy_queue)) {
     assert(stream->shutdown_req);
 
     req = stream->shutdown_req;
@@ -765,13 +808,255 @@ static void uv__write_req_finish(uv_write_t* req) {
   }
 
   /* Add it to the write_completed_queue where it will have its
-   * callback called in the near future.
+   * callback called in the near future. The kernel may still reference data
+   * that was sent with MSG_ZEROCOPY, the callback then waits until it has
+   * released it. Callbacks are made in order so later requests wait as well.
+   *
+   * Feed the watcher either way, that's also what starts the next request.
    */
-  QUEUE_INSERT_TAIL(&stream->write_completed_queue, &req->queue);
+  if (req->zerocopy_sent != req->zerocopy_done ||
+      !QUEUE_EMPTY(&stream->write_zerocopy_queue)) {
+    QUEUE_INSERT_TAIL(&stream->write_zerocopy_queue, &req->queue);
+  } else {
+    QUEUE_INSERT_TAIL(&stream->write_completed_queue, &req->queue);
+  }
   uv__io_feed(stream->loop, &stream->io_watcher);
 }
 
 
+#if defined(UV__HAVE_ZEROCOPY)
+static ssize_t uv__write_zerocopy(uv_stream_t* stream,
+                                  uv_write_t* req,
+                                  struct iovec* iov,
+                                  int iovcnt) {
+  struct msghdr msg;
+  ssize_t n;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = iovcnt;
+
+  do
+    n = sendmsg(uv__stream_fd(stream), &msg, MSG_ZEROCOPY);
+  while (n == -1 && RETRY_ON_WRITE_ERROR(errno));
+
+  /* Out of memory to pin pages with (optmem_max), copy this part instead. */
+  if (n == -1 && errno == ENOBUFS) {
+    do
+      n = uv__writev(uv__stream_fd(stream), iov, iovcnt);
+    while (n == -1 && RETRY_ON_WRITE_ERROR(errno));
+
+    return n;
+  }
+
+  /* Every send that succeeds takes the next notification id, a request's ids
+   * are consecutive because only the head of the write queue is sent.
+   */
+  if (n > 0) {
+    if (req->zerocopy_sent == 0)
+      req->zerocopy_first = stream->zerocopy_next;
+    req->zerocopy_sent++;
+    stream->zerocopy_next++;
+
+    /* The error queue is signalled with POLLERR, which epoll only reports for
+     * file descriptors that are in the interest set. POLLPRI keeps it there
+     * when the stream doesn't read or write.
+     */
+    if (stream->zerocopy_inflight++ == 0)
+      uv__io_start(stream->loop, &stream->io_watcher, UV__POLLPRI);
+  }
+
+  return n;
+}
+
+
+/* Number of ids in the inclusive range [lo, hi] that belong to |req|. The ids
+ * are 32 bits and wrap around.
+ */
+static unsigned int uv__write_zerocopy_overlap(const uv_write_t* req,
+                                               unsigned int lo,
+                                               unsigned int hi) {
+  unsigned int first;
+  unsigned int last;
+
+  if (req->zerocopy_sent == 0)
+    return 0;
+
+  first = req->zerocopy_first;
+  last = first + req->zerocopy_sent - 1;
+
+  if ((int) (lo - first) < 0)
+    lo = first;
+  if ((int) (hi - last) > 0)
+    hi = last;
+  if ((int) (hi - lo) < 0)
+    return 0;
+
+  return hi - lo + 1;
+}
+
+
+static void uv__write_zerocopy_complete(uv_stream_t* stream,
+                                        unsigned int lo,
+                                        unsigned int hi) {
+  uv_write_t* req;
+  QUEUE* q;
+
+  assert(hi - lo < stream->zerocopy_inflight);
+  stream->zerocopy_inflight -= hi - lo + 1;
+
+  /* Completions can arrive while the request is still being sent. */
+  if (!QUEUE_EMPTY(&stream->write_queue)) {
+    q = QUEUE_HEAD(&stream->write_queue);
+    req = QUEUE_DATA(q, uv_write_t, queue);
+    req->zerocopy_done += uv__write_zerocopy_overlap(req, lo, hi);
+  }
+
+  QUEUE_FOREACH(q, &stream->write_zerocopy_queue) {
+    req = QUEUE_DATA(q, uv_write_t, queue);
+    req->zerocopy_done += uv__write_zerocopy_overlap(req, lo, hi);
+  }
+}
+
+
+/* Read the completion notifications off the error queue and move the requests
+ * whose data the kernel has released to the write_completed_queue.
+ */
+static void uv__write_zerocopy_reap(uv_stream_t* stream) {
+  struct sock_extended_err serr;
+  struct cmsghdr* cmsg;
+  struct msghdr msg;
+  uv_write_t* req;
+  QUEUE* q;
+  ssize_t n;
+  int done;
+  union {
+    char data[CMSG_SPACE(sizeof(struct sock_extended_err)) + 64];
+    struct cmsghdr alias;
+  } scratch;
+
+  for (;;) {
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = &scratch.alias;
+    msg.msg_controllen = sizeof(scratch.data);
+
+    do
+      n = recvmsg(uv__stream_fd(stream), &msg, MSG_ERRQUEUE);
+    while (n == -1 && errno == EINTR);
+
+    if (n == -1)
+      break;  /* EAGAIN, the error queue is empty. */
+
+    for (cmsg = CMSG_FIRSTHDR(&msg);
+         cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+      if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+          !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))
+        continue;
+
+      memcpy(&serr, CMSG_DATA(cmsg), sizeof(serr));
+      if (serr.ee_errno != 0 || serr.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+        continue;
+
+      /* ee_info and ee_data are the first and last id of the range. Ranges
+       * that the kernel fell back to copying for (SO_EE_CODE_ZEROCOPY_COPIED)
+       * are complete too.
+       */
+      uv__write_zerocopy_complete(stream, serr.ee_info, serr.ee_data);
+    }
+  }
+
+  done = 0;
+  while (!QUEUE_EMPTY(&stream->write_zerocopy_queue)) {
+    q = QUEUE_HEAD(&stream->write_zerocopy_queue);
+    req = QUEUE_DATA(q, uv_write_t, queue);
+    if (req->zerocopy_sent != req->zerocopy_done)
+      break;
+
+    QUEUE_REMOVE(q);
+    QUEUE_INSERT_TAIL(&stream->write_completed_queue, &req->queue);
+    done = 1;
+  }
+
+  if (done)
+    uv__io_feed(stream->loop, &stream->io_watcher);
+
+  if (stream->zerocopy_inflight == 0)
+    uv__io_stop(stream->loop, &stream->io_watcher, UV__POLLPRI);
+}
+#endif /* defined(UV__HAVE_ZEROCOPY) */
+
+
+/* Write the data of consecutive requests with a single writev() and finish
+ * the ones that were written in full. Requests that pass a handle or that are
+ * sent with MSG_ZEROCOPY are written on their own.
+ */
+static ssize_t uv__write_gather(uv_stream_t* stream, int iovmax) {
+  struct iovec iov[UV__WRITE_GATHER_MAX];
+  unsigned int nbufs;
+  unsigned int nreqs;
+  uv_write_t* req;
+  QUEUE* q;
+  size_t left;
+  size_t size;
+  ssize_t n;
+  int iovcnt;
+
+  if (iovmax > UV__WRITE_GATHER_MAX)
+    iovmax = UV__WRITE_GATHER_MAX;
+
+  iovcnt = 0;
+  nreqs = 0;
+  QUEUE_FOREACH(q, &stream->write_queue) {
+    req = QUEUE_DATA(q, uv_write_t, queue);
+    if (req->send_handle != nullptr || req->zerocopy)
+      break;
+
+    nbufs = req->nbufs - req->write_index;
+    if (nbufs > (unsigned int) (iovmax - iovcnt))
+      nbufs = iovmax - iovcnt;
+
+    memcpy(iov + iovcnt, req->bufs + req->write_index, nbufs * sizeof(iov[0]));
+    iovcnt += nbufs;
+    nreqs++;
+
+    if (iovcnt == iovmax)
+      break;
+  }
+
+  do
+    n = uv__writev(uv__stream_fd(stream), iov, iovcnt);
+  while (n == -1 && RETRY_ON_WRITE_ERROR(errno));
+
+  if (n == -1)
+    return n;
+
+  left = n;
+  while (nreqs-- > 0) {
+    q = QUEUE_HEAD(&stream->write_queue);
+    req = QUEUE_DATA(q, uv_write_t, queue);
+    size = uv__write_req_size(req);
+
+    if (size > left) {
+      if (left > 0)
+        uv__write_req_update(stream, req, left);
+      break;
+    }
+
+    /* Also skips trailing empty buffers, uv__write_req_update() stops at the
+     * first one.
+     */
+    if (size > 0)
+      uv__write_req_update(stream, req, size);
+    req->write_index = req->nbufs;
+    uv__write_req_finish(req);
+    left -= size;
+  }
+
+  return n;
+}
+
+
 static int uv__handle_fd(uv_handle_t* handle) {
   switch (handle->type) {
     case UV_NAMED_PIPE:
@@ -820,6 +1105,24 @@ start:
   if (iovcnt > iovmax)
     iovcnt = iovmax;
 
+  /* Corked streams write the data of all queued requests in one go. */
+  if ((stream->flags & UV_HANDLE_CORKED) &&
+      req->send_handle == nullptr &&
+      !req->zerocopy &&
+      QUEUE_NEXT(q) != &stream->write_queue) {
+    n = uv__write_gather(stream, iovmax);
+    if (n == -1 && !IS_TRANSIENT_WRITE_ERROR(errno, nullptr)) {
+      err = UV__ERR(errno);
+      goto error;
+    }
+
+    /* Finishing a request fed the watcher, that writes the rest. */
+    if (QUEUE_HEAD(&stream->write_queue) != q)
+      return;
+
+    goto partial;
+  }
+
   /*
    * Now do the actual writev. Note that we've been updating the pointers
    * inside the iov each time we write. So there is no need to offset it.
@@ -873,6 +1176,10 @@ start:
     /* Ensure the handle isn't sent again in case this is a partial write. */
     if (n >= 0)
       req->send_handle = nullptr;
+#if defined(UV__HAVE_ZEROCOPY)
+  } else if (req->zerocopy) {
+    n = uv__write_zerocopy(stream, req, iov, iovcnt);
+#endif
   } else {
     do
       n = uv__writev(uv__stream_fd(stream), iov, iovcnt);
@@ -889,6 +1196,7 @@ start:
     return;  /* TODO(bnoordhuis) Start trying to write the next request. */
   }
 
+partial:
   /* If this is a blocking stream, try again. */
   if (stream->flags & UV_HANDLE_BLOCKING_WRITES)
     goto start;
@@ -985,14 +1293,28 @@ uv_handle_type uv__handle_type(int fd) {
 }
 
 
-static void uv__stream_eof(uv_stream_t* stream, const uv_buf_t* buf) {
+/* Hand the outcome of a read to the read callback that the stream has. */
+static void uv__stream_read_cb(uv_stream_t* stream,
+                               ssize_t nread,
+                               const uv_buf_t bufs[],
+                               unsigned int nbufs) {
+  if (stream->read_bufs_cb != nullptr)
+    stream->read_bufs_cb(stream, nread, bufs, nbufs);
+  else
+    stream->read_cb(stream, nread, &bufs[0]);
+}
+
+
+static void uv__stream_eof(uv_stream_t* stream,
+                           const uv_buf_t bufs[],
+                           unsigned int nbufs) {
   stream->flags |= UV_HANDLE_READ_EOF;
   stream->flags &= ~UV_HANDLE_READING;
   uv__io_stop(stream->loop, &stream->io_watcher, POLLIN);
   if (!uv__io_active(&stream->io_watcher, POLLOUT))
     uv__handle_stop(stream);
   uv__stream_osx_interrupt_select(stream);
-  stream->read_cb(stream, UV_EOF, buf);
+  uv__stream_read_cb(stream, UV_EOF, bufs, nbufs);
 }
 
 
@@ -1095,6 +1417,163 @@ static int uv__stream_recv_cmsg(uv_stream_t* stream, struct msghdr* msg) {
 }
 
 
+/* Pooled reads. All streams that read with uv_read_start_pooled() read into
+ * the loop's current block, every read takes the next slice of it. A slice
+ * starts with a pointer to its block, blocks are reference counted and go
+ * back to the pool when their last slice is released. The loop holds a
+ * reference to the block that it reads into and starts over at the front
+ * whenever that's the only one left, which is the normal case when the read
+ * callbacks don't hold on to the data.
+ */
+#define READ_POOL_BLOCK_SIZE (64 * 1024)
+
+/* A block with less room left than this is swapped for another one. */
+#define READ_POOL_MIN_SLICE (8 * 1024)
+
+/* Free blocks that are kept for reuse, any more are freed. */
+#define READ_POOL_MAX_FREE 16
+
+#define READ_POOL_ALIGN(n) (((n) + 15) & ~static_cast<size_t>(15))
+#define READ_POOL_HEADER READ_POOL_ALIGN(sizeof(uv__read_block*))
+#define READ_POOL_START READ_POOL_ALIGN(sizeof(uv__read_block))
+
+struct uv__read_block {
+  uv__read_block* next;
+  unsigned int refs;
+};
+
+struct uv__read_pool {
+  uv__read_block* current;
+  size_t offset;
+  uv__read_block* free;
+  unsigned int nfree;
+};
+
+
+static uv__read_pool* read_pool(uv_loop_t* loop) {
+  return static_cast<uv__read_pool*>(loop->read_pool);
+}
+
+
+static uv__read_block* read_slice_block(const uv_buf_t* buf) {
+  uv__read_block* block;
+
+  memcpy(&block, buf->base - READ_POOL_HEADER, sizeof(block));
+  return block;
+}
+
+
+static void read_block_unref(uv__read_pool* pool, uv__read_block* block) {
+  if (--block->refs > 0)
+    return;
+
+  if (pool->nfree >= READ_POOL_MAX_FREE) {
+    uv__free(block);
+    return;
+  }
+
+  block->next = pool->free;
+  pool->free = block;
+  pool->nfree++;
+}
+
+
+/* The alloc_cb of streams that were started with uv_read_start_pooled(). */
+static void uv__read_pool_alloc(uv_handle_t* handle,
+                                size_t suggested_size,
+                                uv_buf_t* buf) {
+  uv__read_block* block;
+  uv__read_pool* pool;
+
+  (void) suggested_size;
+  pool = read_pool(handle->loop);
+  block = pool->current;
+
+  /* Nobody holds on to a slice, start over. */
+  if (block != nullptr && block->refs == 1)
+    pool->offset = READ_POOL_START;
+
+  if (block == nullptr ||
+      READ_POOL_BLOCK_SIZE - pool->offset <
+          READ_POOL_HEADER + READ_POOL_MIN_SLICE) {
+    if (block != nullptr)
+      read_block_unref(pool, block);
+
+    block = pool->free;
+    if (block != nullptr) {
+      pool->free = block->next;
+      pool->nfree--;
+    } else {
+      block = static_cast<uv__read_block*>(uv__malloc(READ_POOL_BLOCK_SIZE));
+      if (block == nullptr) {
+        pool->current = nullptr;
+        *buf = uv_buf_init(nullptr, 0);
+        return;
+      }
+    }
+
+    block->refs = 1;
+    pool->current = block;
+    pool->offset = READ_POOL_START;
+  }
+
+  buf->base = reinterpret_cast<char*>(block) + pool->offset + READ_POOL_HEADER;
+  buf->len = READ_POOL_BLOCK_SIZE - pool->offset - READ_POOL_HEADER;
+}
+
+
+/* Make a slice of the first `nread` bytes of a buffer from
+ * uv__read_pool_alloc(), the caller owns a reference to it.
+ */
+static void uv__read_pool_commit(uv_loop_t* loop, uv_buf_t* buf, size_t nread) {
+  uv__read_block* block;
+  uv__read_pool* pool;
+
+  pool = read_pool(loop);
+  block = pool->current;
+  memcpy(buf->base - READ_POOL_HEADER, &block, sizeof(block));
+  block->refs++;
+  pool->offset = READ_POOL_ALIGN(pool->offset + READ_POOL_HEADER + nread);
+  buf->len = nread;
+}
+
+
+/* Set the length of every buffer to the part of the `nread` bytes that went
+ * into it.
+ */
+static void uv__read_bufs_fill(uv_buf_t bufs[],
+                               unsigned int nbufs,
+                               size_t nread) {
+  unsigned int i;
+
+  for (i = 0; i < nbufs; i++) {
+    if (bufs[i].len > nread)
+      bufs[i].len = nread;
+    nread -= bufs[i].len;
+  }
+}
+
+
+void uv__read_pool_delete(uv_loop_t* loop) {
+  uv__read_block* block;
+  uv__read_pool* pool;
+
+  pool = read_pool(loop);
+  if (pool == nullptr)
+    return;
+
+  while (pool->free != nullptr) {
+    block = pool->free;
+    pool->free = block->next;
+    uv__free(block);
+  }
+
+  uv__free(pool->current);
+  uv__free(pool);
+  loop->read_pool = nullptr;
+}
+
+
 #ifdef __clang__
 # pragma clang diagnostic push
 # pragma clang diagnostic ignored "-Wgnu-folding-constant"
@@ -1102,18 +1581,23 @@ static int uv__stream_recv_cmsg(uv_stream_t* stream, struct msghdr* msg) {
 #endif
 
 static void uv__read(uv_stream_t* stream) {
-  uv_buf_t buf;
+  uv_buf_t bufs[UV__READ_MAX_BUFS];
+  unsigned int nbufs;
+  unsigned int i;
+  ssize_t buflen;
   ssize_t nread;
   struct msghdr msg;
   char cmsg_space[CMSG_SPACE(UV__CMSG_FD_SIZE)];
   int count;
   int err;
   int is_ipc;
+  int pooled;
 
-  stream->flags &= ~UV_HANDLE_READ_PARTIAL;
+  stream->flags &= ~(UV_HANDLE_READ_PARTIAL | UV_HANDLE_READ_PENDING);
 
   /* Prevent loop starvation when the data comes in as fast as (or faster than)
-   * we can read it. XXX Need to rearm fd if we switch to edge-triggered I/O.
+   * we can read it. Edge-triggered streams are fed back to the loop when they
+   * run out of budget, see below.
    */
   count = 32;
 
@@ -1122,32 +1606,47 @@ static void uv__read(uv_stream_t* stream) {
   /* XXX: Maybe instead of having UV_HANDLE_READING we just test if
    * tcp->read_cb is nullptr or not?
    */
-  while (stream->read_cb
+  while ((stream->read_cb || stream->read_bufs_cb)
       && (stream->flags & UV_HANDLE_READING)
       && (count-- > 0)) {
-    assert(stream->alloc_cb != nullptr);
+    pooled = 0;
+    if (stream->alloc_bufs_cb != nullptr) {
+      nbufs = ARRAY_SIZE(bufs);
+      stream->alloc_bufs_cb((uv_handle_t*)stream, 64 * 1024, bufs, &nbufs);
+      assert(nbufs <= ARRAY_SIZE(bufs));
+    } else {
+      assert(stream->alloc_cb != nullptr);
+      bufs[0] = uv_buf_init(nullptr, 0);
+      stream->alloc_cb((uv_handle_t*)stream, 64 * 1024, &bufs[0]);
+      pooled = stream->alloc_cb == uv__read_pool_alloc;
+      nbufs = 1;
+    }
+
+    buflen = 0;
+    for (i = 0; i < nbufs; i++)
+      buflen += bufs[i].len;
 
-    buf = uv_buf_init(nullptr, 0);
-    stream->alloc_cb((uv_handle_t*)stream, 64 * 1024, &buf);
-    if (buf.base == nullptr || buf.len == 0) {
+    if (nbufs == 0 || bufs[0].base == nullptr || buflen == 0) {
       /* User indicates it can't or won't handle the read. */
-      stream->read_cb(stream, UV_ENOBUFS, &buf);
+      uv__stream_read_cb(stream, UV_ENOBUFS, bufs, nbufs);
       return;
     }
 
-    assert(buf.base != nullptr);
     assert(uv__stream_fd(stream) >= 0);
 
     if (!is_ipc) {
       do {
-        nread = read(uv__stream_fd(stream), buf.base, buf.len);
+        if (nbufs == 1)
+          nread = read(uv__stream_fd(stream), bufs[0].base, bufs[0].len);
+        else
+          nread = readv(uv__stream_fd(stream), (struct iovec*) bufs, nbufs);
       }
       while (nread < 0 && errno == EINTR);
     } else {
       /* ipc uses recvmsg */
       msg.msg_flags = 0;
-      msg.msg_iov = (struct iovec*) &buf;
-      msg.msg_iovlen = 1;
+      msg.msg_iov = (struct iovec*) bufs;
+      msg.msg_iovlen = nbufs;
       msg.msg_name = nullptr;
       msg.msg_namelen = 0;
       /* Set up to receive a descriptor even if one isn't in the message */
@@ -1168,15 +1667,15 @@ static void uv__read(uv_stream_t* stream) {
           uv__io_start(stream->loop, &stream->io_watcher, POLLIN);
           uv__stream_osx_interrupt_select(stream);
         }
-        stream->read_cb(stream, 0, &buf);
+        uv__stream_read_cb(stream, 0, bufs, nbufs);
 #if defined(__CYGWIN__) || defined(__MSYS__)
       } else if (errno == ECONNRESET && stream->type == UV_NAMED_PIPE) {
-        uv__stream_eof(stream, &buf);
+        uv__stream_eof(stream, bufs, nbufs);
         return;
 #endif
       } else {
         /* Error. User should call uv_close(). */
-        stream->read_cb(stream, UV__ERR(errno), &buf);
+        uv__stream_read_cb(stream, UV__ERR(errno), bufs, nbufs);
         if (stream->flags & UV_HANDLE_READING) {
           stream->flags &= ~UV_HANDLE_READING;
           uv__io_stop(stream->loop, &stream->io_watcher, POLLIN);
@@ -1187,16 +1686,14 @@ static void uv__read(uv_stream_t* stream) {
       }
       return;
     } else if (nread == 0) {
-      uv__stream_eof(stream, &buf);
+      uv__stream_eof(stream, bufs, nbufs);
       return;
     } else {
       /* Successful read */
-      ssize_t buflen = buf.len;
-
       if (is_ipc) {
         err = uv__stream_recv_cmsg(stream, &msg);
         if (err != 0) {
-          stream->read_cb(stream, err, &buf);
+          uv__stream_read_cb(stream, err, bufs, nbufs);
           return;
         }
       }
@@ -1216,7 +1713,7 @@ static void uv__read(uv_stream_t* stream) {
           nread = uv__recvmsg(uv__stream_fd(stream), &msg, 0);
           err = uv__stream_recv_cmsg(stream, &msg);
           if (err != 0) {
-            stream->read_cb(stream, err, &buf);
+            uv__stream_read_cb(stream, err, bufs, nbufs);
             msg.msg_iov = old;
             return;
           }
@@ -1224,7 +1721,17 @@ static void uv__read(uv_stream_t* stream) {
         msg.msg_iov = old;
       }
 #endif
-      stream->read_cb(stream, nread, &buf);
+      if (pooled) {
+        uv__read_pool_commit(stream->loop, &bufs[0], nread);
+        stream->read_cb(stream, nread, &bufs[0]);
+        uv_read_buf_release(stream->loop, &bufs[0]);
+      } else if (stream->read_bufs_cb != nullptr) {
+        /* Tell how much landed in every buffer. */
+        uv__read_bufs_fill(bufs, nbufs, nread);
+        stream->read_bufs_cb(stream, nread, bufs, nbufs);
+      } else {
+        stream->read_cb(stream, nread, &bufs[0]);
+      }
 
       /* Return if we didn't fill the buffer, there is no more data to read. */
       if (nread < buflen) {
@@ -1233,6 +1740,16 @@ static void uv__read(uv_stream_t* stream) {
       }
     }
   }
+
+  /* Out of budget but there may still be data to read. The kernel won't tell
+   * us about it again when the stream is edge-triggered, continue reading
+   * from the pending phase of the next loop iteration instead.
+   */
+  if ((stream->io_watcher.pevents & UV__POLLET) &&
+      (stream->flags & UV_HANDLE_READING)) {
+    stream->flags |= UV_HANDLE_READ_PENDING;
+    uv__io_feed(stream->loop, &stream->io_watcher);
+  }
 }
 
 
@@ -1289,8 +1806,14 @@ static void uv__stream_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
 
   assert(uv__stream_fd(stream) >= 0);
 
+#if defined(UV__HAVE_ZEROCOPY)
+  if ((events & (POLLERR | UV__POLLPRI)) && stream->zerocopy_inflight > 0)
+    uv__write_zerocopy_reap(stream);
+#endif
+
   /* Ignore POLLHUP here. Even if it's set, there may still be data to read. */
-  if (events & (POLLIN | POLLERR | POLLHUP))
+  if ((events & (POLLIN | POLLERR | POLLHUP)) ||
+      (stream->flags & UV_HANDLE_READ_PENDING))
     uv__read(stream);
 
   if (uv__stream_fd(stream) == -1)
@@ -1307,7 +1830,7 @@ static void uv__stream_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
       (stream->flags & UV_HANDLE_READ_PARTIAL) &&
       !(stream->flags & UV_HANDLE_READ_EOF)) {
     uv_buf_t buf = { nullptr, 0 };
-    uv__stream_eof(stream, &buf);
+    uv__stream_eof(stream, &buf, 0);
   }
 
   if (uv__stream_fd(stream) == -1)
@@ -1432,6 +1955,10 @@ int uv_write2(uv_write_t* req,
   req->handle = stream;
   req->error = 0;
   req->send_handle = send_handle;
+  req->zerocopy = 0;
+  req->zerocopy_first = 0;
+  req->zerocopy_sent = 0;
+  req->zerocopy_done = 0;
   QUEUE_INIT(&req->queue);
 
   req->bufs = req->bufsml;
@@ -1446,6 +1973,16 @@ int uv_write2(uv_write_t* req,
   req->write_index = 0;
   stream->write_queue_size += uv__count_bufs(bufs, nbufs);
 
+  /* Small writes are cheaper to copy than to pin and wait for. uv_try_write()
+   * doesn't keep the data alive after it returns.
+   */
+  if (stream->type == UV_TCP &&
+      (stream->flags & UV_HANDLE_TCP_ZEROCOPY) &&
+      cb != uv_try_write_cb &&
+      uv__count_bufs(bufs, nbufs) >= stream->zerocopy_threshold) {
+    req->zerocopy = 1;
+  }
+
   /* Append the request to write_queue. */
   QUEUE_INSERT_TAIL(&stream->write_queue, &req->queue);
 
@@ -1456,6 +1993,18 @@ int uv_write2(uv_write_t* req,
   if (stream->connect_req) {
     /* Still connecting, do nothing. */
   }
+  else if ((stream->flags & UV_HANDLE_CORKED) && cb != uv_try_write_cb) {
+    /* Gather the writes that are made during this loop iteration, they are
+     * flushed together from the pending queue. Unless they add up to the
+     * threshold or the stream already waits until it is writable.
+     */
+    if (!uv__io_active(&stream->io_watcher, POLLOUT)) {
+      if (stream->write_queue_size >= stream->cork_threshold)
+        uv__write(stream);
+      else
+        uv__io_feed(stream->loop, &stream->io_watcher);
+    }
+  }
   else if (empty_queue) {
     uv__write(stream);
   }
@@ -1540,9 +2089,11 @@ int uv_try_write(uv_stream_t* stream,
 }
 
 
-int uv_read_start(uv_stream_t* stream,
-                  uv_alloc_cb alloc_cb,
-                  uv_read_cb read_cb) {
+static int uv__read_start(uv_stream_t* stream,
+                          uv_alloc_cb alloc_cb,
+                          uv_read_cb read_cb,
+                          uv_alloc_bufs_cb alloc_bufs_cb,
+                          uv_read_bufs_cb read_bufs_cb) {
   assert(stream->type == UV_TCP || stream->type == UV_NAMED_PIPE ||
       stream->type == UV_TTY);
 
@@ -1562,10 +2113,12 @@ int uv_read_start(uv_stream_t* stream,
    * not start the IO watcher.
    */
   assert(uv__stream_fd(stream) >= 0);
-  assert(alloc_cb);
+  assert(alloc_cb || alloc_bufs_cb);
 
   stream->read_cb = read_cb;
   stream->alloc_cb = alloc_cb;
+  stream->read_bufs_cb = read_bufs_cb;
+  stream->alloc_bufs_cb = alloc_bufs_cb;
 
   uv__io_start(stream->loop, &stream->io_watcher, POLLIN);
   uv__handle_start(stream);
@@ -1575,6 +2128,48 @@ int uv_read_start(uv_stream_t* stream,
 }
 
 
+int uv_read_start(uv_stream_t* stream,
+                  uv_alloc_cb alloc_cb,
+                  uv_read_cb read_cb) {
+  return uv__read_start(stream, alloc_cb, read_cb, nullptr, nullptr);
+}
+
+
+int uv_read_start_bufs(uv_stream_t* stream,
+                       uv_alloc_bufs_cb alloc_cb,
+                       uv_read_bufs_cb read_cb) {
+  if (alloc_cb == nullptr || read_cb == nullptr)
+    return UV_EINVAL;
+
+  return uv__read_start(stream, nullptr, nullptr, alloc_cb, read_cb);
+}
+
+
+int uv_read_start_pooled(uv_stream_t* stream, uv_read_cb read_cb) {
+  uv__read_pool* pool;
+
+  if (stream->loop->read_pool == nullptr) {
+    pool = static_cast<uv__read_pool*>(uv__calloc(1, sizeof(*pool)));
+    if (pool == nullptr)
+      return UV_ENOMEM;
+    stream->loop->read_pool = pool;
+  }
+
+  return uv_read_start(stream, uv__read_pool_alloc, read_cb);
+}
+
+
+void uv_read_buf_retain(uv_loop_t* loop, const uv_buf_t* buf) {
+  (void) loop;
+  read_slice_block(buf)->refs++;
+}
+
+
+void uv_read_buf_release(uv_loop_t* loop, const uv_buf_t* buf) {
+  read_block_unref(read_pool(loop), read_slice_block(buf));
+}
+
+
 int uv_read_stop(uv_stream_t* stream) {
   if (!(stream->flags & UV_HANDLE_READING))
     return 0;
@@ -1587,6 +2182,8 @@ int uv_read_stop(uv_stream_t* stream) {
 
   stream->read_cb = nullptr;
   stream->alloc_cb = nullptr;
+  stream->read_bufs_cb = nullptr;
+  stream->alloc_bufs_cb = nullptr;
   return 0;
 }
 
@@ -1679,3 +2276,45 @@ int uv_stream_set_blocking(uv_stream_t* handle, int blocking) {
    */
   return uv__nonblock(uv__stream_fd(handle), !blocking);
 }
+
+
+int uv_stream_set_cork(uv_stream_t* handle, int enable, size_t threshold) {
+  if (handle->type != UV_TCP && handle->type != UV_NAMED_PIPE)
+    return UV_EINVAL;
+
+  if (enable) {
+    handle->flags |= UV_HANDLE_CORKED;
+    handle->cork_threshold = threshold;
+    return 0;
+  }
+
+  handle->flags &= ~UV_HANDLE_CORKED;
+  handle->cork_threshold = 0;
+
+  /* Flush what has been gathered so far. */
+  if (!QUEUE_EMPTY(&handle->write_queue) &&
+      handle->connect_req == nullptr &&
+      !uv__io_active(&handle->io_watcher, POLLOUT)) {
+    uv__io_feed(handle->loop, &handle->io_watcher);
+  }
+
+  return 0;
+}
+
+
+int uv_stream_set_edge_triggered(uv_stream_t* handle, int enable) {
+  if (UV__POLLET == 0)
+    return UV_ENOTSUP;
+
+  if (handle->type != UV_TCP && handle->type != UV_NAMED_PIPE)
+    return UV_EINVAL;
+
+  /* The trigger mode is picked up when the file descriptor is (re)registered
+   * with the kernel, i.e. the next time the stream starts reading or writing.
+   */
+  if (uv__io_active(&handle->io_watcher, POLLIN | POLLOUT))
+    return UV_EBUSY;
+
+  uv__io_set_edge_triggered(&handle->io_watcher, enable);
+  return 0;
+}
@@ -193,6 +193,8 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
     auto nfds = 1u;
     auto saved_errno = 0;
 
+    uv__metrics_phase(loop, UV_METRICS_PHASE_POLL);
+
     if (pset != nullptr)
       pthread_sigmask(SIG_BLOCK, pset, nullptr);
 
@@ -221,7 +223,7 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
      * timeout == 0 (i.e. non-blocking poll) but there is no guarantee that the
      * operating system didn't reschedule our process while in the syscall.
      */
-    SAVE_ERRNO(uv__update_time(loop));
+    SAVE_ERRNO(uv__metrics_poll_wakeup(loop, nfds));
 
     if (events[0].portev_source == 0) {
       if (timeout == 0)
@@ -392,6 +392,17 @@ int uv__tcp_keepalive(int fd, int on, unsigned int delay) {
 }
 
 
+int uv__tcp_zerocopy(int fd, int on) {
+#if defined(UV__HAVE_ZEROCOPY)
+  if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)))
+    return UV__ERR(errno);
+  return 0;
+#else
+  return UV_ENOTSUP;
+#endif
+}
+
+
 int uv_tcp_nodelay(uv_tcp_t* handle, int on) {
 
   if (uv__stream_fd(handle) != -1) {
@@ -430,6 +441,32 @@ int uv_tcp_keepalive(uv_tcp_t* handle, int on, unsigned int delay) {
 }
 
 
+int uv_tcp_zerocopy(uv_tcp_t* handle, int on, size_t threshold) {
+#if defined(UV__HAVE_ZEROCOPY)
+  /* Writes that are already queued keep the mode they were queued with. The
+   * socket option stays on when disabling, notifications for zero-copy sends
+   * that are still in flight must keep coming.
+   */
+  if (on && uv__stream_fd(handle) != -1) {
+    auto err = uv__tcp_zerocopy(uv__stream_fd(handle), 1);
+    if (err)
+      return err;
+  }
+
+  if (on)
+    handle->flags |= UV_HANDLE_TCP_ZEROCOPY;
+  else
+    handle->flags &= ~UV_HANDLE_TCP_ZEROCOPY;
+
+  handle->zerocopy_threshold = threshold;
+
+  return 0;
+#else
+  return UV_ENOTSUP;
+#endif
+}
+
+
 int uv_tcp_simultaneous_accepts(uv_tcp_t* handle, int enable) {
   if (enable)
     handle->flags &= ~UV_HANDLE_TCP_SINGLE_ACCEPT;
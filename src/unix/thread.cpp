@@ -32,6 +32,10 @@
 
 #include <limits.h>
 #include "../utils/allocator.cpp"
+
+#if defined(__linux__)
+# include <sched.h>
+#endif
 #ifdef __MVS__
 #include <sys/ipc.h>
 #include <sys/sem.h>
@@ -200,6 +204,70 @@ static size_t thread_stack_size() {
 }
 
 
+#if defined(__linux__)
+static void thread_cpuset(cpu_set_t* set, const char* cpumask) {
+  CPU_ZERO(set);
+  for (auto i = 0; i < CPU_SETSIZE; i++)
+    if (cpumask[i])
+      CPU_SET(i, set);
+}
+#endif
+
+
+int uv_cpumask_size(void) {
+#if defined(__linux__)
+  return CPU_SETSIZE;
+#else
+  return UV_ENOTSUP;
+#endif
+}
+
+
+int uv_thread_setaffinity(uv_thread_t* tid,
+                          const char* cpumask,
+                          char* oldmask,
+                          size_t mask_size) {
+#if defined(__linux__)
+  cpu_set_t set;
+  int err;
+
+  if (mask_size < static_cast<size_t>(uv_cpumask_size()))
+    return UV_EINVAL;
+
+  if (oldmask != nullptr) {
+    err = pthread_getaffinity_np(*tid, sizeof(set), &set);
+    if (err)
+      return UV__ERR(err);
+
+    for (auto i = 0; i < CPU_SETSIZE; i++)
+      oldmask[i] = CPU_ISSET(i, &set) != 0;
+  }
+
+  thread_cpuset(&set, cpumask);
+  return UV__ERR(pthread_setaffinity_np(*tid, sizeof(set), &set));
+#else
+  (void) tid;
+  (void) cpumask;
+  (void) oldmask;
+  (void) mask_size;
+  return UV_ENOTSUP;
+#endif
+}
+
+
+int uv_thread_getcpu(void) {
+#if defined(__linux__)
+  auto cpu = sched_getcpu();
+  if (cpu < 0)
+    return UV__ERR(errno);
+
+  return cpu;
+#else
+  return UV_ENOTSUP;
+#endif
+}
+
+
 int uv_thread_create(uv_thread_t *tid, void (*entry)(void *arg), void *arg) {
   auto params = uv_thread_options_t{};
   params.flags = UV_THREAD_NO_FLAGS;
@@ -233,17 +301,37 @@ int uv_thread_create_ex(uv_thread_t* tid,
 #endif
   }
 
-  pthread_attr_t* attr;
+  auto has_affinity = (params->flags & UV_THREAD_HAS_AFFINITY) != 0;
+  if (has_affinity) {
+#if defined(__linux__)
+    if (params->mask_size < static_cast<size_t>(uv_cpumask_size()))
+      return UV_EINVAL;
+#else
+    return UV_ENOTSUP;
+#endif
+  }
+
+  pthread_attr_t* attr = nullptr;
   auto attr_storage = pthread_attr_t{};
-  if (stack_size > 0) {
+  if (stack_size > 0 || has_affinity) {
     attr = &attr_storage;
 
     if (pthread_attr_init(attr))
       abort();
+  }
 
+  if (stack_size > 0)
     if (pthread_attr_setstacksize(attr, stack_size))
       abort();
+
+#if defined(__linux__)
+  if (has_affinity) {
+    cpu_set_t set;
+    thread_cpuset(&set, params->cpumask);
+    if (pthread_attr_setaffinity_np(attr, sizeof(set), &set))
+      abort();
   }
+#endif
 
   f.in = entry;
   auto err = pthread_create(tid, attr, f.out, arg);
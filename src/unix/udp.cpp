@@ -510,6 +510,7 @@ int uv__udp_bind(uv_udp_t* handle,
       return err;
     fd = err;
     handle->io_watcher.fd = fd;
+    uv__socket_busy_poll(handle->loop, fd);
   }
 
   if (flags & UV_UDP_REUSEADDR) {
@@ -954,6 +955,9 @@ int uv_udp_init_ex(uv_loop_t* loop, uv_udp_t* handle, unsigned int flags) {
   QUEUE_INIT(&handle->write_queue);
   QUEUE_INIT(&handle->write_completed_queue);
 
+  if (fd != -1)
+    uv__socket_busy_poll(loop, fd);
+
   return 0;
 }
 
@@ -981,6 +985,7 @@ int uv_udp_open(uv_udp_t* handle, uv_os_sock_t sock) {
     return err;
 
   handle->io_watcher.fd = sock;
+  uv__socket_busy_poll(handle->loop, sock);
   if (uv__udp_is_connected(handle))
     handle->flags |= UV_HANDLE_UDP_CONNECTED;
 
@@ -689,12 +689,32 @@ void uv__fs_readdir_cleanup(uv_fs_t* req) {
 }
 
 
+static int uv__loop_set_work_priority(uv_loop_t* loop, int priority) {
+  if (priority != UV_WORK_PRIORITY_NORMAL &&
+      priority != UV_WORK_PRIORITY_HIGH &&
+      priority != UV_WORK_PRIORITY_LOW) {
+    return UV_EINVAL;
+  }
+
+  loop->work_priority = priority;
+  return 0;
+}
+
+
 int uv_loop_configure(uv_loop_t* loop, uv_loop_option option, ...) {
   va_list ap;
 
   va_start(ap, option);
   /* Any platform-agnostic options should be handled here. */
-  auto err = uv__loop_configure(loop, option, ap);
+  auto err = 0;
+  if (option == UV_LOOP_TIMER_WHEEL)
+    err = uv__timer_wheel_init(loop);
+  else if (option == UV_LOOP_THREADPOOL)
+    loop->threadpool = va_arg(ap, uv_threadpool_t*);
+  else if (option == UV_LOOP_WORK_PRIORITY)
+    err = uv__loop_set_work_priority(loop, va_arg(ap, int));
+  else
+    err = uv__loop_configure(loop, option, ap);
   va_end(ap);
 
   return err;
@@ -747,6 +767,7 @@ int uv_loop_close(uv_loop_t* loop) {
   }
 
   uv__loop_close(loop);
+  uv__timer_wheel_delete(loop);
 
 #ifndef NDEBUG
   saved_data = loop->data;
@@ -94,6 +94,9 @@ enum {
   /* Used by uv_tcp_t and uv_udp_t handles */
   UV_HANDLE_IPV6                        = 0x00400000,
 
+  /* Used by streams on UNIX. */
+  UV_HANDLE_CORKED                      = 0x00800000,
+
   /* Only used by uv_tcp_t handles. */
   UV_HANDLE_TCP_NODELAY                 = 0x01000000,
   UV_HANDLE_TCP_KEEPALIVE               = 0x02000000,
@@ -101,6 +104,7 @@ enum {
   UV_HANDLE_TCP_ACCEPT_STATE_CHANGING   = 0x08000000,
   UV_HANDLE_TCP_SOCKET_CLOSED           = 0x10000000,
   UV_HANDLE_SHARED_TCP_SOCKET           = 0x20000000,
+  UV_HANDLE_TCP_ZEROCOPY                = 0x40000000,
 
   /* Only used by uv_udp_t handles. */
   UV_HANDLE_UDP_PROCESSING              = 0x01000000,
@@ -121,7 +125,10 @@ enum {
   UV_SIGNAL_ONE_SHOT                    = 0x02000000,
 
   /* Only used by uv_poll_t handles. */
-  UV_HANDLE_POLL_SLOW                   = 0x01000000
+  UV_HANDLE_POLL_SLOW                   = 0x01000000,
+
+  /* Only used by uv_timer_t handles. */
+  UV_HANDLE_TIMER_NS                    = 0x01000000
 };
 
 auto uv__loop_configure(uv_loop_t* loop, uv_loop_option option, va_list ap) -> int;
@@ -175,6 +182,7 @@ auto uv__fs_poll_close(uv_fs_poll_t* handle) -> void;
 
 auto uv__getaddrinfo_translate_error(int sys_err) -> int;    /* EAI_* error. */
 
+/* In the same order as uv_threadpool_work_kind. */
 enum uv__work_kind {
   UV__WORK_CPU,
   UV__WORK_FAST_IO,
@@ -201,6 +209,22 @@ auto uv__next_timeout(const uv_loop_t* loop) -> int;
 auto uv__run_timers(uv_loop_t* loop) -> void;
 auto uv__timer_close(uv_timer_t* handle) -> void;
 
+/* Nanosecond timers. uv__hrtimer_arm() asks the platform to wake up the loop
+ * at |due| on the uv_hrtime() clock, zero means there are none left. It's a
+ * no-op where the poll timeout in milliseconds is all there is.
+ */
+auto uv__run_hrtimers(uv_loop_t* loop) -> void;
+auto uv__hrtimer_arm(uv_loop_t* loop, uint64_t due) -> void;
+
+typedef struct uv__timer_wheel_s uv__timer_wheel_t;
+
+auto uv__timer_wheel_init(uv_loop_t* loop) -> int;
+auto uv__timer_wheel_delete(uv_loop_t* loop) -> void;
+auto uv__timer_wheel_insert(uv_loop_t* loop, uv_timer_t* handle) -> void;
+auto uv__timer_wheel_remove(uv_loop_t* loop, uv_timer_t* handle) -> void;
+auto uv__timer_wheel_next(const uv_loop_t* loop) -> uint64_t;
+auto uv__timer_wheel_expired(uv_loop_t* loop) -> uv_timer_t*;
+
 template <class _loop>
 auto uv__has_active_reqs(_loop loop) noexcept -> bool{
   return ((loop)->active_reqs.count > 0);
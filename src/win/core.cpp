@@ -235,7 +235,7 @@ int uv_loop_init(uv_loop_t* loop) {
   loop->time = 0;
   uv_update_time(loop);
 
-  QUEUE_INIT(&loop->wq);
+  loop->wq = nullptr;
   QUEUE_INIT(&loop->handle_queue);
   loop->active_reqs.count = 0;
   loop->active_handles = 0;
@@ -256,6 +256,10 @@ int uv_loop_init(uv_loop_t* loop) {
   }
 
   heap_init(timer_heap);
+  heap_init((heap*) &loop->hrtimer_heap);
+  loop->timer_wheel = nullptr;
+  loop->threadpool = nullptr;
+  loop->work_priority = UV_WORK_PRIORITY_NORMAL;
 
   loop->check_handles = nullptr;
   loop->prepare_handles = nullptr;
@@ -273,21 +277,8 @@ int uv_loop_init(uv_loop_t* loop) {
   loop->timer_counter = 0;
   loop->stop_flag = 0;
 
-  auto err = uv_mutex_init(&loop->wq_mutex);
-  if (err){
-    uv__free(timer_heap);
-    loop->timer_heap = nullptr;
-
-    CloseHandle(loop->iocp);
-    loop->iocp = INVALID_HANDLE_VALUE;
-
-    return err;
-  }
-
-  err = uv_async_init(loop, &loop->wq_async, uv__work_done);
+  auto err = uv_async_init(loop, &loop->wq_async, uv__work_done);
   if (err){  
-    uv_mutex_destroy(&loop->wq_mutex);
-
     uv__free(timer_heap);
     loop->timer_heap = nullptr;
 
@@ -302,8 +293,6 @@ int uv_loop_init(uv_loop_t* loop) {
 
   err = uv__loops_add(loop);
   if (err){  
-    uv_mutex_destroy(&loop->wq_mutex);
-
     uv__free(timer_heap);
     loop->timer_heap = nullptr;
 
@@ -350,12 +339,11 @@ void uv__loop_close(uv_loop_t* loop) {
       closesocket(sock);
   }
 
-  uv_mutex_lock(&loop->wq_mutex);
-  assert(QUEUE_EMPTY(&loop->wq) && "thread pool work queue not empty!");
+  assert(loop->wq == nullptr && "thread pool work queue not empty!");
   assert(!uv__has_active_reqs(loop));
-  uv_mutex_unlock(&loop->wq_mutex);
-  uv_mutex_destroy(&loop->wq_mutex);
 
+  heap_free((heap*) loop->timer_heap);
+  heap_free((heap*) &loop->hrtimer_heap);
   uv__free(loop->timer_heap);
   loop->timer_heap = nullptr;
 
@@ -379,6 +367,11 @@ int uv_loop_fork() {
 }
 
 
+void uv__hrtimer_arm(uv_loop_t* loop, uint64_t due) {
+  /* Nothing finer grained than the poll timeout. */
+}
+
+
 int uv_backend_timeout(const uv_loop_t* loop) {
   if (loop->stop_flag != 0)
     return 0;
@@ -399,6 +392,24 @@ int uv_backend_timeout(const uv_loop_t* loop) {
 }
 
 
+uint64_t uv_metrics_busy_poll_time(const uv_loop_t* loop) {
+  (void) loop;
+  return 0;
+}
+
+
+uint64_t uv_metrics_idle_time(const uv_loop_t* loop) {
+  (void) loop;
+  return 0;
+}
+
+
+int uv_metrics_info(const uv_loop_t* loop, uv_metrics_t* metrics) {
+  (void) loop, metrics;
+  return UV_ENOSYS;
+}
+
+
 static void uv__poll_wine(uv_loop_t* loop, DWORD timeout) {
 
   auto timeout_time = loop->time + timeout;
@@ -92,6 +92,38 @@ int uv_read_start(uv_stream_t* handle, uv_alloc_cb alloc_cb,
 }
 
 
+int uv_read_start_bufs(uv_stream_t* handle,
+                       uv_alloc_bufs_cb alloc_cb,
+                       uv_read_bufs_cb read_cb) {
+  (void) handle;
+  (void) alloc_cb;
+  (void) read_cb;
+  return UV_ENOTSUP;
+}
+
+
+/* Reads complete into the buffer that was handed to the kernel when they were
+ * queued, there's no point where a shared buffer could be picked.
+ */
+int uv_read_start_pooled(uv_stream_t* handle, uv_read_cb read_cb) {
+  (void) handle;
+  (void) read_cb;
+  return UV_ENOTSUP;
+}
+
+
+void uv_read_buf_retain(uv_loop_t* loop, const uv_buf_t* buf) {
+  (void) loop;
+  (void) buf;
+}
+
+
+void uv_read_buf_release(uv_loop_t* loop, const uv_buf_t* buf) {
+  (void) loop;
+  (void) buf;
+}
+
+
 int uv_read_stop(uv_stream_t* handle) {
 
   if (!(handle->flags & UV_HANDLE_READING))
@@ -234,3 +266,15 @@ int uv_stream_set_blocking(uv_stream_t* handle, int blocking) {
 
   return 0;
 }
+
+
+int uv_stream_set_edge_triggered(uv_stream_t* handle, int enable) {
+  (void)handle, enable;
+  return UV_ENOTSUP;
+}
+
+
+int uv_stream_set_cork(uv_stream_t* handle, int enable, size_t threshold) {
+  (void)handle, enable, threshold;
+  return UV_ENOTSUP;
+}
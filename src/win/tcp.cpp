@@ -1245,6 +1245,10 @@ int uv_tcp_keepalive(uv_tcp_t* handle, int enable, unsigned int delay) {
   return 0;
 }
 
+int uv_tcp_zerocopy(uv_tcp_t* handle, int enable, size_t threshold) {
+  return UV_ENOTSUP;
+}
+
 int uv_tcp_simultaneous_accepts(uv_tcp_t* handle, int enable) {
   if (handle->flags & UV_HANDLE_CONNECTION) {
     return UV_EINVAL;
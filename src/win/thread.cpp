@@ -104,6 +104,51 @@ static UINT __stdcall uv__thread_start(void* arg) {
   return 0;
 }
 
+int uv_cpumask_size(void) {
+  return static_cast<int>(sizeof(DWORD_PTR) * 8);
+}
+
+
+static DWORD_PTR uv__thread_affinity_mask(const char* cpumask) {
+  DWORD_PTR mask;
+  int i;
+
+  mask = 0;
+  for (i = 0; i < uv_cpumask_size(); i++)
+    if (cpumask[i])
+      mask |= static_cast<DWORD_PTR>(1) << i;
+
+  return mask;
+}
+
+
+int uv_thread_setaffinity(uv_thread_t* tid,
+                          const char* cpumask,
+                          char* oldmask,
+                          size_t mask_size) {
+  DWORD_PTR previous;
+  int i;
+
+  if (mask_size < static_cast<size_t>(uv_cpumask_size()))
+    return UV_EINVAL;
+
+  previous = SetThreadAffinityMask(*tid, uv__thread_affinity_mask(cpumask));
+  if (previous == 0)
+    return uv_translate_sys_error(GetLastError());
+
+  if (oldmask != nullptr)
+    for (i = 0; i < uv_cpumask_size(); i++)
+      oldmask[i] = (previous >> i) & 1;
+
+  return 0;
+}
+
+
+int uv_thread_getcpu(void) {
+  return static_cast<int>(GetCurrentProcessorNumber());
+}
+
+
 int uv_thread_create(uv_thread_t *tid, void (*entry)(void *arg), void *arg) {
   uv_thread_options_t params;
   params.flags = UV_THREAD_NO_FLAGS;
@@ -118,6 +163,11 @@ int uv_thread_create_ex(uv_thread_t* tid,
   auto stack_size =
       params->flags & UV_THREAD_HAS_STACK_SIZE ? params->stack_size : 0;
 
+  if ((params->flags & UV_THREAD_HAS_AFFINITY) &&
+      params->mask_size < static_cast<size_t>(uv_cpumask_size())) {
+    return UV_EINVAL;
+  }
+
   if (stack_size != 0) {
     SYSTEM_INFO sysinfo;
     GetNativeSystemInfo(&sysinfo);
@@ -153,6 +203,8 @@ int uv_thread_create_ex(uv_thread_t* tid,
     err = 0;
     *tid = thread;
     ctx->self = thread;
+    if (params->flags & UV_THREAD_HAS_AFFINITY)
+      SetThreadAffinityMask(thread, uv__thread_affinity_mask(params->cpumask));
     ResumeThread(thread);
   }
 
@@ -23,8 +23,11 @@ BENCHMARK_DECLARE (sizes)
 BENCHMARK_DECLARE (loop_count)
 BENCHMARK_DECLARE (loop_count_timed)
 BENCHMARK_DECLARE (ping_pongs)
+BENCHMARK_DECLARE (ping_pong_latency)
+BENCHMARK_DECLARE (ping_pong_latency_busy_poll)
 BENCHMARK_DECLARE (ping_udp)
 BENCHMARK_DECLARE (tcp_write_batch)
+BENCHMARK_DECLARE (tcp_write_batch_corked)
 BENCHMARK_DECLARE (tcp4_pound_100)
 BENCHMARK_DECLARE (tcp4_pound_1000)
 BENCHMARK_DECLARE (pipe_pound_100)
@@ -74,8 +77,16 @@ BENCHMARK_DECLARE (async_pummel_4)
 BENCHMARK_DECLARE (async_pummel_8)
 BENCHMARK_DECLARE (spawn)
 BENCHMARK_DECLARE (thread_create)
+BENCHMARK_DECLARE (queue_work)
+BENCHMARK_DECLARE (queue_work_batch)
+BENCHMARK_DECLARE (queue_work_cancel)
 BENCHMARK_DECLARE (million_async)
 BENCHMARK_DECLARE (million_timers)
+BENCHMARK_DECLARE (million_timers_wheel)
+BENCHMARK_DECLARE (million_timers_restart)
+BENCHMARK_DECLARE (million_timers_restart_wheel)
+BENCHMARK_DECLARE (timer_wakeups)
+BENCHMARK_DECLARE (timer_wakeups_slack)
 HELPER_DECLARE    (tcp4_blackhole_server)
 HELPER_DECLARE    (tcp_pump_server)
 HELPER_DECLARE    (pipe_pump_server)
@@ -91,9 +102,18 @@ TASK_LIST_START
   BENCHMARK_ENTRY  (ping_pongs)
   BENCHMARK_HELPER (ping_pongs, tcp4_echo_server)
 
+  BENCHMARK_ENTRY  (ping_pong_latency)
+  BENCHMARK_HELPER (ping_pong_latency, tcp4_echo_server)
+
+  BENCHMARK_ENTRY  (ping_pong_latency_busy_poll)
+  BENCHMARK_HELPER (ping_pong_latency_busy_poll, tcp4_echo_server)
+
   BENCHMARK_ENTRY  (tcp_write_batch)
   BENCHMARK_HELPER (tcp_write_batch, tcp4_blackhole_server)
 
+  BENCHMARK_ENTRY  (tcp_write_batch_corked)
+  BENCHMARK_HELPER (tcp_write_batch_corked, tcp4_blackhole_server)
+
   BENCHMARK_ENTRY  (tcp_pump100_client)
   BENCHMARK_HELPER (tcp_pump100_client, tcp_pump_server)
 
@@ -159,6 +179,14 @@ TASK_LIST_START
 
   BENCHMARK_ENTRY  (spawn)
   BENCHMARK_ENTRY  (thread_create)
+  BENCHMARK_ENTRY  (queue_work)
+  BENCHMARK_ENTRY  (queue_work_batch)
+  BENCHMARK_ENTRY  (queue_work_cancel)
   BENCHMARK_ENTRY  (million_async)
   BENCHMARK_ENTRY  (million_timers)
+  BENCHMARK_ENTRY  (million_timers_wheel)
+  BENCHMARK_ENTRY  (million_timers_restart)
+  BENCHMARK_ENTRY  (million_timers_restart_wheel)
+  BENCHMARK_ENTRY  (timer_wakeups)
+  BENCHMARK_ENTRY  (timer_wakeups_slack)
 TASK_LIST_END
@@ -24,6 +24,11 @@
 #include "utils/allocator.cpp"
 #define NUM_TIMERS (10 * 1000 * 1000)
 
+/* Idle connection timeouts that keep getting pushed back. */
+#define NUM_IDLE_TIMERS (1000 * 1000)
+#define NUM_RESTARTS (10 * 1000 * 1000)
+#define IDLE_TIMEOUT 30000
+
 static int timer_cb_called;
 static int close_cb_called;
 
@@ -38,7 +43,18 @@ static void close_cb(uv_handle_t* handle) {
 }
 
 
-BENCHMARK_IMPL(million_timers) {
+static uv_loop_t* timers_loop(int use_wheel) {
+  uv_loop_t* loop;
+
+  loop = uv_default_loop();
+  if (use_wheel)
+    ASSERT(0 == uv_loop_configure(loop, UV_LOOP_TIMER_WHEEL));
+
+  return loop;
+}
+
+
+static int million_timers(const char* name, int use_wheel) {
   uv_loop_t* loop;
   uint64_t before_all;
   uint64_t before_run;
@@ -50,7 +66,7 @@ BENCHMARK_IMPL(million_timers) {
   auto *timers = test_create_ptrstruct<uv_timer_t>(NUM_TIMERS * sizeof(uv_timer_t));
   ASSERT(timers != nullptr);
 
-  loop = uv_default_loop();
+  loop = timers_loop(use_wheel);
   timeout = 0;
 
   before_all = uv_hrtime();
@@ -74,12 +90,97 @@ BENCHMARK_IMPL(million_timers) {
   ASSERT(close_cb_called == NUM_TIMERS);
   free(timers);
 
-  fprintf(stderr, "%.2f seconds total\n", (after_all - before_all) / 1e9);
-  fprintf(stderr, "%.2f seconds init\n", (before_run - before_all) / 1e9);
-  fprintf(stderr, "%.2f seconds dispatch\n", (after_run - before_run) / 1e9);
-  fprintf(stderr, "%.2f seconds cleanup\n", (after_all - after_run) / 1e9);
+  fprintf(stderr, "%s: %.2f seconds total\n",
+          name, (after_all - before_all) / 1e9);
+  fprintf(stderr, "%s: %.2f seconds init\n",
+          name, (before_run - before_all) / 1e9);
+  fprintf(stderr, "%s: %.2f seconds dispatch\n",
+          name, (after_run - before_run) / 1e9);
+  fprintf(stderr, "%s: %.2f seconds cleanup\n",
+          name, (after_all - after_run) / 1e9);
   fflush(stderr);
 
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+static int million_timers_restart(const char* name, int use_wheel) {
+  uv_loop_t* loop;
+  uint64_t before_all;
+  uint64_t before_restart;
+  uint64_t after_restart;
+  uint64_t after_all;
+  int i;
+  int j;
+
+  auto *timers =
+      test_create_ptrstruct<uv_timer_t>(NUM_IDLE_TIMERS * sizeof(uv_timer_t));
+  ASSERT(timers != nullptr);
+
+  loop = timers_loop(use_wheel);
+
+  before_all = uv_hrtime();
+  for (i = 0; i < NUM_IDLE_TIMERS; i++) {
+    ASSERT(0 == uv_timer_init(loop, timers + i));
+    ASSERT(0 == uv_timer_start(timers + i,
+                               timer_cb,
+                               IDLE_TIMEOUT + i % 1000,
+                               IDLE_TIMEOUT));
+  }
+
+  /* Traffic on a connection restarts its timeout. Spin the loop now and then
+   * so time moves forward, like it would when there's I/O.
+   */
+  before_restart = uv_hrtime();
+  for (i = 0, j = 0; i < NUM_RESTARTS; i++) {
+    if (i % 100000 == 0)
+      ASSERT(0 != uv_run(loop, UV_RUN_NOWAIT));
+    ASSERT(0 == uv_timer_again(timers + j));
+    j = (j + 7919) % NUM_IDLE_TIMERS;
+  }
+  after_restart = uv_hrtime();
+
+  for (i = 0; i < NUM_IDLE_TIMERS; i++)
+    uv_close((uv_handle_t*) (timers + i), close_cb);
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  after_all = uv_hrtime();
+
+  ASSERT(timer_cb_called == 0);
+  ASSERT(close_cb_called == NUM_IDLE_TIMERS);
+  free(timers);
+
+  fprintf(stderr, "%s: %.2f seconds total\n",
+          name, (after_all - before_all) / 1e9);
+  fprintf(stderr, "%s: %.2f seconds init\n",
+          name, (before_restart - before_all) / 1e9);
+  fprintf(stderr, "%s: %.2f seconds restart\n",
+          name, (after_restart - before_restart) / 1e9);
+  fprintf(stderr, "%s: %.2f seconds cleanup\n",
+          name, (after_all - after_restart) / 1e9);
+  fflush(stderr);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+BENCHMARK_IMPL(million_timers) {
+  return million_timers("million_timers", 0);
+}
+
+
+BENCHMARK_IMPL(million_timers_wheel) {
+  return million_timers("million_timers_wheel", 1);
+}
+
+
+BENCHMARK_IMPL(million_timers_restart) {
+  return million_timers_restart("million_timers_restart", 0);
+}
+
+
+BENCHMARK_IMPL(million_timers_restart_wheel) {
+  return million_timers_restart("million_timers_restart_wheel", 1);
+}
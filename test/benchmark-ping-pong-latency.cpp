@@ -0,0 +1,164 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_PINGS (20 * 1000)
+
+/* Spin budget of the busy polling variant, in microseconds. */
+#define BUSY_POLL_US 50
+
+static char PING[] = "PING\n";
+
+static uv_loop_t* loop;
+static uv_tcp_t tcp_client;
+static uv_connect_t connect_req;
+static uv_write_t write_req;
+static char slab[64];
+
+static uint64_t latencies[NUM_PINGS];
+static uint64_t ping_time;
+static int state;
+static int pongs;
+static int close_cb_called;
+
+
+static int compare_latency(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*) a;
+  uint64_t y = *(const uint64_t*) b;
+
+  return x < y ? -1 : x > y;
+}
+
+
+static void alloc_cb(uv_handle_t* handle,
+                     size_t suggested_size,
+                     uv_buf_t* buf) {
+  buf->base = slab;
+  buf->len = sizeof(slab);
+}
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+}
+
+
+static void write_ping(void) {
+  uv_buf_t buf;
+
+  buf = uv_buf_init(PING, sizeof(PING) - 1);
+  ping_time = uv_hrtime();
+
+  ASSERT(0 == uv_write(&write_req,
+                       (uv_stream_t*) &tcp_client,
+                       &buf,
+                       1,
+                       write_cb));
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+  ssize_t i;
+
+  ASSERT(nread >= 0);
+
+  for (i = 0; i < nread; i++) {
+    ASSERT(buf->base[i] == PING[state]);
+    state = (state + 1) % (sizeof(PING) - 1);
+    if (state != 0)
+      continue;
+
+    latencies[pongs++] = uv_hrtime() - ping_time;
+
+    if (pongs == NUM_PINGS)
+      uv_close((uv_handle_t*) stream, close_cb);
+    else
+      write_ping();
+  }
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  ASSERT(status == 0);
+  ASSERT(0 == uv_read_start(req->handle, alloc_cb, read_cb));
+  write_ping();
+}
+
+
+static int ping_pong_latency(const char* name, unsigned int busy_poll) {
+  struct sockaddr_in addr;
+  int err;
+
+  loop = uv_default_loop();
+
+  if (busy_poll != 0) {
+    err = uv_loop_configure(loop, UV_LOOP_BUSY_POLL, busy_poll);
+    if (err == UV_ENOSYS)
+      RETURN_SKIP("Busy polling is not supported on this platform.");
+    ASSERT(err == 0);
+  }
+
+  ASSERT(0 == uv_ip4_addr("127.0.0.1", TEST_PORT, &addr));
+  ASSERT(0 == uv_tcp_init(loop, &tcp_client));
+  ASSERT(0 == uv_tcp_nodelay(&tcp_client, 1));
+  ASSERT(0 == uv_tcp_connect(&connect_req,
+                             &tcp_client,
+                             (const struct sockaddr*) &addr,
+                             connect_cb));
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(pongs == NUM_PINGS);
+  ASSERT(close_cb_called == 1);
+
+  qsort(latencies, NUM_PINGS, sizeof(latencies[0]), compare_latency);
+
+  fprintf(stderr,
+          "%s: %d roundtrips, p50 %.1f us, p99 %.1f us, spun %.1f ms\n",
+          name,
+          NUM_PINGS,
+          latencies[NUM_PINGS / 2] / 1e3,
+          latencies[NUM_PINGS - NUM_PINGS / 100] / 1e3,
+          uv_metrics_busy_poll_time(loop) / 1e6);
+  fflush(stderr);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+BENCHMARK_IMPL(ping_pong_latency) {
+  return ping_pong_latency("ping_pong_latency", 0);
+}
+
+
+BENCHMARK_IMPL(ping_pong_latency_busy_poll) {
+  return ping_pong_latency("ping_pong_latency_busy_poll", BUSY_POLL_US);
+}
@@ -0,0 +1,172 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include "uv.h"
+#include "task.h"
+
+#include <stdio.h>
+
+#define NUM_ROUNDS 1000
+#define ROUND_SIZE 1000
+
+static uv_work_t reqs[ROUND_SIZE];
+static uint64_t submit_time;
+static int rounds;
+static int completed;
+static int batches;
+static int cancelled;
+static uv_sem_t blocker_sem;
+
+
+static void work_cb(uv_work_t* req) {
+}
+
+
+static void after_work_cb(uv_work_t* req, int status) {
+  ASSERT(status == 0);
+  completed++;
+}
+
+
+static void blocker_work_cb(uv_work_t* req) {
+  uv_sem_wait(&blocker_sem);
+}
+
+
+static void cancelled_cb(uv_work_t* req, int status) {
+  ASSERT(status == UV_ECANCELED);
+  cancelled++;
+}
+
+
+static void after_batch_cb(uv_work_t* batch, unsigned int nreqs) {
+  ASSERT(batch == reqs);
+  ASSERT(nreqs == ROUND_SIZE);
+  batches++;
+}
+
+
+/* Each round submits ROUND_SIZE requests from the loop thread, like a loop
+ * that fans out small tasks on every tick, and waits for them.
+ */
+static int queue_work(const char* name, int batch) {
+  uv_loop_t* loop;
+  uint64_t start;
+  uint64_t duration;
+  int i;
+
+  loop = uv_default_loop();
+  duration = uv_hrtime();
+
+  for (rounds = 0; rounds < NUM_ROUNDS; rounds++) {
+    start = uv_hrtime();
+
+    if (batch) {
+      ASSERT(0 == uv_queue_work_batch(loop,
+                                      reqs,
+                                      ROUND_SIZE,
+                                      work_cb,
+                                      after_work_cb,
+                                      after_batch_cb));
+    } else {
+      for (i = 0; i < ROUND_SIZE; i++)
+        ASSERT(0 == uv_queue_work(loop, &reqs[i], work_cb, after_work_cb));
+    }
+
+    submit_time += uv_hrtime() - start;
+    ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  }
+
+  duration = uv_hrtime() - duration;
+
+  ASSERT(completed == NUM_ROUNDS * ROUND_SIZE);
+  ASSERT(batches == (batch ? NUM_ROUNDS : 0));
+
+  fprintf(stderr,
+          "%s: %.0f submissions/s, %.0f completions/s\n",
+          name,
+          completed / (submit_time / 1e9),
+          completed / (duration / 1e9));
+  fflush(stderr);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+BENCHMARK_IMPL(queue_work) {
+  return queue_work("queue_work", 0);
+}
+
+
+BENCHMARK_IMPL(queue_work_batch) {
+  return queue_work("queue_work_batch", 1);
+}
+
+
+/* Each round submits ROUND_SIZE requests to a threadpool whose only thread
+ * is busy and cancels all of them again, like a server that sheds load while
+ * the disk stalls.
+ */
+BENCHMARK_IMPL(queue_work_cancel) {
+  uv_threadpool_t pool;
+  uv_work_t blocker;
+  uv_loop_t* loop;
+  uint64_t cancel_time;
+  uint64_t start;
+  int i;
+
+  loop = uv_default_loop();
+  ASSERT(0 == uv_sem_init(&blocker_sem, 0));
+  ASSERT(0 == uv_threadpool_init(&pool, 1, 1));
+  ASSERT(0 == uv_loop_configure(loop, UV_LOOP_THREADPOOL, &pool));
+  ASSERT(0 == uv_queue_work(loop, &blocker, blocker_work_cb, after_work_cb));
+
+  cancel_time = 0;
+  for (rounds = 0; rounds < NUM_ROUNDS; rounds++) {
+    for (i = 0; i < ROUND_SIZE; i++)
+      ASSERT(0 == uv_queue_work(loop, &reqs[i], work_cb, cancelled_cb));
+
+    start = uv_hrtime();
+    for (i = 0; i < ROUND_SIZE; i++)
+      ASSERT(0 == uv_cancel((uv_req_t*) &reqs[i]));
+    cancel_time += uv_hrtime() - start;
+
+    while (cancelled < (rounds + 1) * ROUND_SIZE)
+      uv_run(loop, UV_RUN_ONCE);
+  }
+
+  uv_sem_post(&blocker_sem);
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(completed == 1);
+  ASSERT(cancelled == NUM_ROUNDS * ROUND_SIZE);
+
+  fprintf(stderr,
+          "queue_work_cancel: %.0f cancellations/s\n",
+          cancelled / (cancel_time / 1e9));
+  fflush(stderr);
+
+  ASSERT(0 == uv_loop_close(loop));
+  ASSERT(0 == uv_threadpool_close(&pool));
+  uv_sem_destroy(&blocker_sem);
+  return 0;
+}
@@ -0,0 +1,108 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <stdio.h>
+
+#define NUM_TIMERS 100
+#define RUN_TIME_MS 5000
+
+/* Heartbeat-style timers with distinct periods, none of which needs to be
+ * exact to the millisecond.
+ */
+#define TIMER_PERIOD(i) (50 + 7 * (i))
+#define TIMER_SLACK 50
+
+static uv_timer_t timers[NUM_TIMERS];
+static uv_timer_t stop_timer;
+static uv_prepare_t prepare_handle;
+static unsigned long wakeups;
+static unsigned long timer_cb_called;
+
+
+static void prepare_cb(uv_prepare_t* handle) {
+  wakeups++;
+}
+
+
+static void timer_cb(uv_timer_t* handle) {
+  timer_cb_called++;
+}
+
+
+static void stop_cb(uv_timer_t* handle) {
+  int i;
+
+  for (i = 0; i < NUM_TIMERS; i++)
+    uv_close((uv_handle_t*) &timers[i], nullptr);
+
+  uv_close((uv_handle_t*) &prepare_handle, nullptr);
+  uv_close((uv_handle_t*) handle, nullptr);
+}
+
+
+static int timer_wakeups(const char* name, uint64_t slack) {
+  uv_loop_t* loop;
+  int i;
+
+  loop = uv_default_loop();
+
+  for (i = 0; i < NUM_TIMERS; i++) {
+    ASSERT(0 == uv_timer_init(loop, &timers[i]));
+    uv_timer_set_slack(&timers[i], slack);
+    ASSERT(0 == uv_timer_start(&timers[i],
+                               timer_cb,
+                               TIMER_PERIOD(i),
+                               TIMER_PERIOD(i)));
+  }
+
+  ASSERT(0 == uv_timer_init(loop, &stop_timer));
+  ASSERT(0 == uv_timer_start(&stop_timer, stop_cb, RUN_TIME_MS, 0));
+
+  ASSERT(0 == uv_prepare_init(loop, &prepare_handle));
+  ASSERT(0 == uv_prepare_start(&prepare_handle, prepare_cb));
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+
+  fprintf(stderr,
+          "%s: %lu wakeups for %lu timer callbacks in %.1fs (%.0f/s)\n",
+          name,
+          wakeups,
+          timer_cb_called,
+          RUN_TIME_MS / 1e3,
+          wakeups / (RUN_TIME_MS / 1e3));
+  fflush(stderr);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+BENCHMARK_IMPL(timer_wakeups) {
+  return timer_wakeups("timer_wakeups", 0);
+}
+
+
+BENCHMARK_IMPL(timer_wakeups_slack) {
+  return timer_wakeups("timer_wakeups_slack", TIMER_SLACK);
+}
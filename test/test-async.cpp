@@ -132,3 +132,57 @@ TEST_IMPL(async) {
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+#define PENDING_HANDLES 64
+
+static uv_async_t pending_handles[PENDING_HANDLES];
+static int pending_cb_called[PENDING_HANDLES];
+
+
+static void pending_cb(uv_async_t* handle) {
+  int i;
+
+  i = handle - pending_handles;
+  pending_cb_called[i]++;
+
+  /* Closing a handle that is signalled but hasn't been seen yet takes it off
+   * the pending list.
+   */
+  if (i == 1)
+    uv_close((uv_handle_t*) &pending_handles[2], nullptr);
+
+  uv_close((uv_handle_t*) handle, nullptr);
+}
+
+
+TEST_IMPL(async_pending) {
+  uv_loop_t* loop;
+  int i;
+
+  loop = uv_default_loop();
+
+  for (i = 0; i < PENDING_HANDLES; i++)
+    ASSERT(0 == uv_async_init(loop, &pending_handles[i], pending_cb));
+
+  /* Sends coalesce until the callback has run. */
+  for (i = 0; i < PENDING_HANDLES; i++) {
+    ASSERT(0 == uv_async_send(&pending_handles[i]));
+    ASSERT(0 == uv_async_send(&pending_handles[i]));
+  }
+
+  for (i = 0; i < PENDING_HANDLES; i += 4)
+    uv_close((uv_handle_t*) &pending_handles[i], nullptr);
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+
+  for (i = 0; i < PENDING_HANDLES; i++) {
+    if (i % 4 == 0 || i == 2)
+      ASSERT(pending_cb_called[i] == 0);
+    else
+      ASSERT(pending_cb_called[i] == 1);
+  }
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
@@ -33,6 +33,11 @@ TEST_DECLARE   (loop_stop)
 TEST_DECLARE   (loop_update_time)
 TEST_DECLARE   (loop_backend_timeout)
 TEST_DECLARE   (loop_configure)
+TEST_DECLARE   (loop_configure_io_uring)
+TEST_DECLARE   (loop_configure_busy_poll)
+TEST_DECLARE   (metrics_idle_time)
+TEST_DECLARE   (metrics_info)
+TEST_DECLARE   (metrics_events)
 TEST_DECLARE   (default_loop_close)
 TEST_DECLARE   (barrier_1)
 TEST_DECLARE   (barrier_2)
@@ -77,6 +82,8 @@ TEST_DECLARE   (tty_file)
 TEST_DECLARE   (tty_pty)
 TEST_DECLARE   (stdio_over_pipes)
 TEST_DECLARE   (stdio_emulate_iocp)
+TEST_DECLARE   (stream_edge_triggered)
+TEST_DECLARE   (stream_cork)
 TEST_DECLARE   (ip6_pton)
 TEST_DECLARE   (connect_unspecified)
 TEST_DECLARE   (ipc_heavy_traffic_deadlock_bug)
@@ -110,6 +117,7 @@ TEST_DECLARE   (tcp_write_fail)
 TEST_DECLARE   (tcp_try_write)
 TEST_DECLARE   (tcp_try_write_error)
 TEST_DECLARE   (tcp_write_queue_order)
+TEST_DECLARE   (tcp_zerocopy)
 TEST_DECLARE   (tcp_open)
 TEST_DECLARE   (tcp_open_twice)
 TEST_DECLARE   (tcp_open_bound)
@@ -145,6 +153,8 @@ TEST_DECLARE   (tcp_flags)
 TEST_DECLARE   (tcp_write_to_half_open_connection)
 TEST_DECLARE   (tcp_unexpected_read)
 TEST_DECLARE   (tcp_read_stop)
+TEST_DECLARE   (read_bufs)
+TEST_DECLARE   (read_pooled)
 TEST_DECLARE   (tcp_bind6_error_addrinuse)
 TEST_DECLARE   (tcp_bind6_error_addrnotavail)
 TEST_DECLARE   (tcp_bind6_error_fault)
@@ -212,6 +222,10 @@ TEST_DECLARE   (timer_start_twice)
 TEST_DECLARE   (timer_order)
 TEST_DECLARE   (timer_huge_timeout)
 TEST_DECLARE   (timer_huge_repeat)
+TEST_DECLARE   (timer_wheel)
+TEST_DECLARE   (timer_heap_order)
+TEST_DECLARE   (timer_slack)
+TEST_DECLARE   (timer_start_ns)
 TEST_DECLARE   (timer_run_once)
 TEST_DECLARE   (timer_from_check)
 TEST_DECLARE   (timer_is_closing)
@@ -256,6 +270,7 @@ TEST_DECLARE   (active)
 TEST_DECLARE   (embed)
 TEST_DECLARE   (async)
 TEST_DECLARE   (async_null_cb)
+TEST_DECLARE   (async_pending)
 TEST_DECLARE   (eintr_handling)
 TEST_DECLARE   (get_currentexe)
 TEST_DECLARE   (process_title)
@@ -411,6 +426,15 @@ TEST_DECLARE   (fs_invalid_mkdir_name)
 TEST_DECLARE   (strscpy)
 TEST_DECLARE   (threadpool_queue_work_simple)
 TEST_DECLARE   (threadpool_queue_work_einval)
+TEST_DECLARE   (threadpool_queue_work_burst)
+TEST_DECLARE   (threadpool_queue_work_order)
+TEST_DECLARE   (threadpool_queue_work_batch)
+TEST_DECLARE   (threadpool_set_size)
+TEST_DECLARE   (threadpool_instances)
+TEST_DECLARE   (threadpool_priority)
+TEST_DECLARE   (threadpool_metrics)
+TEST_DECLARE   (threadpool_affinity)
+TEST_DECLARE   (threadpool_queue_work_chunked)
 TEST_DECLARE   (threadpool_multiple_event_loops)
 TEST_DECLARE   (threadpool_cancel_getaddrinfo)
 TEST_DECLARE   (threadpool_cancel_getnameinfo)
@@ -421,6 +445,7 @@ TEST_DECLARE   (threadpool_cancel_single)
 TEST_DECLARE   (thread_local_storage)
 TEST_DECLARE   (thread_stack_size)
 TEST_DECLARE   (thread_stack_size_explicit)
+TEST_DECLARE   (thread_affinity)
 TEST_DECLARE   (thread_mutex)
 TEST_DECLARE   (thread_mutex_recursive)
 TEST_DECLARE   (thread_rwlock)
@@ -530,6 +555,11 @@ TASK_LIST_START
   TEST_ENTRY  (loop_update_time)
   TEST_ENTRY  (loop_backend_timeout)
   TEST_ENTRY  (loop_configure)
+  TEST_ENTRY  (loop_configure_io_uring)
+  TEST_ENTRY  (loop_configure_busy_poll)
+  TEST_ENTRY  (metrics_idle_time)
+  TEST_ENTRY  (metrics_info)
+  TEST_ENTRY  (metrics_events)
   TEST_ENTRY  (default_loop_close)
   TEST_ENTRY  (barrier_1)
   TEST_ENTRY  (barrier_2)
@@ -585,6 +615,8 @@ TASK_LIST_START
   TEST_ENTRY  (tty_pty)
   TEST_ENTRY  (stdio_over_pipes)
   TEST_ENTRY  (stdio_emulate_iocp)
+  TEST_ENTRY  (stream_edge_triggered)
+  TEST_ENTRY  (stream_cork)
   TEST_ENTRY  (ip6_pton)
   TEST_ENTRY  (connect_unspecified)
   TEST_ENTRY  (ipc_heavy_traffic_deadlock_bug)
@@ -644,6 +676,8 @@ TASK_LIST_START
 
   TEST_ENTRY  (tcp_write_queue_order)
 
+  TEST_ENTRY  (tcp_zerocopy)
+
   TEST_ENTRY  (tcp_open)
   TEST_HELPER (tcp_open, tcp4_echo_server)
   TEST_ENTRY  (tcp_open_twice)
@@ -688,6 +722,8 @@ TASK_LIST_START
 
   TEST_ENTRY  (tcp_read_stop)
   TEST_HELPER (tcp_read_stop, tcp4_echo_server)
+  TEST_ENTRY  (read_bufs)
+  TEST_ENTRY  (read_pooled)
 
   TEST_ENTRY  (tcp_bind6_error_addrinuse)
   TEST_ENTRY  (tcp_bind6_error_addrnotavail)
@@ -767,6 +803,10 @@ TASK_LIST_START
   TEST_ENTRY  (timer_order)
   TEST_ENTRY  (timer_huge_timeout)
   TEST_ENTRY  (timer_huge_repeat)
+  TEST_ENTRY  (timer_wheel)
+  TEST_ENTRY  (timer_heap_order)
+  TEST_ENTRY  (timer_slack)
+  TEST_ENTRY  (timer_start_ns)
   TEST_ENTRY  (timer_run_once)
   TEST_ENTRY  (timer_from_check)
   TEST_ENTRY  (timer_is_closing)
@@ -817,6 +857,7 @@ TASK_LIST_START
 
   TEST_ENTRY  (async)
   TEST_ENTRY  (async_null_cb)
+  TEST_ENTRY  (async_pending)
   TEST_ENTRY  (eintr_handling)
 
   TEST_ENTRY  (get_currentexe)
@@ -1039,6 +1080,15 @@ TASK_LIST_START
   TEST_ENTRY  (strscpy)
   TEST_ENTRY  (threadpool_queue_work_simple)
   TEST_ENTRY  (threadpool_queue_work_einval)
+  TEST_ENTRY  (threadpool_queue_work_burst)
+  TEST_ENTRY  (threadpool_queue_work_order)
+  TEST_ENTRY  (threadpool_queue_work_batch)
+  TEST_ENTRY  (threadpool_set_size)
+  TEST_ENTRY  (threadpool_instances)
+  TEST_ENTRY  (threadpool_priority)
+  TEST_ENTRY  (threadpool_metrics)
+  TEST_ENTRY  (threadpool_affinity)
+  TEST_ENTRY  (threadpool_queue_work_chunked)
   TEST_ENTRY_CUSTOM (threadpool_multiple_event_loops, 0, 0, 60000)
   TEST_ENTRY  (threadpool_cancel_getaddrinfo)
   TEST_ENTRY  (threadpool_cancel_getnameinfo)
@@ -1049,6 +1099,7 @@ TASK_LIST_START
   TEST_ENTRY  (thread_local_storage)
   TEST_ENTRY  (thread_stack_size)
   TEST_ENTRY  (thread_stack_size_explicit)
+  TEST_ENTRY  (thread_affinity)
   TEST_ENTRY  (thread_mutex)
   TEST_ENTRY  (thread_mutex_recursive)
   TEST_ENTRY  (thread_rwlock)
@@ -16,6 +16,12 @@
 #include "uv.h"
 #include "task.h"
 
+#include <string.h>
+
+#ifndef _WIN32
+# include <sys/socket.h>
+#endif
+
 static void timer_cb(uv_timer_t* handle) {
   uv_close((uv_handle_t*) handle, nullptr);
 }
@@ -36,3 +42,130 @@ TEST_IMPL(loop_configure) {
   ASSERT(0 == uv_loop_close(&loop));
   return 0;
 }
+
+
+#ifndef _WIN32
+static uv_pipe_t io_uring_pipes[2];
+static uv_write_t io_uring_write_req;
+static int io_uring_read_cb_called;
+static int io_uring_write_cb_called;
+
+
+static void io_uring_alloc_cb(uv_handle_t* handle,
+                              size_t suggested_size,
+                              uv_buf_t* buf) {
+  static char slab[64];
+  buf->base = slab;
+  buf->len = sizeof(slab);
+}
+
+
+static void io_uring_write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  io_uring_write_cb_called++;
+}
+
+
+static void io_uring_read_cb(uv_stream_t* stream,
+                             ssize_t nread,
+                             const uv_buf_t* buf) {
+  if (nread == 0)
+    return;
+
+  io_uring_read_cb_called++;
+
+  if (stream == (uv_stream_t*) &io_uring_pipes[1]) {
+    /* Closing this end makes the other end see EOF. */
+    ASSERT(nread == 4);
+    ASSERT(0 == memcmp(buf->base, "PING", 4));
+    uv_close((uv_handle_t*) stream, nullptr);
+  } else {
+    ASSERT(nread == UV_EOF);
+    uv_close((uv_handle_t*) stream, nullptr);
+  }
+}
+
+
+static void io_uring_timer_cb(uv_timer_t* handle) {
+  uv_buf_t buf;
+
+  buf = uv_buf_init(const_cast<char*>("PING"), 4);
+  ASSERT(0 == uv_write(&io_uring_write_req,
+                       (uv_stream_t*) &io_uring_pipes[0],
+                       &buf,
+                       1,
+                       io_uring_write_cb));
+  uv_close((uv_handle_t*) handle, nullptr);
+}
+#endif
+
+
+TEST_IMPL(loop_configure_io_uring) {
+#ifdef _WIN32
+  uv_loop_t loop;
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(UV_ENOSYS == uv_loop_configure(&loop, UV_LOOP_USE_IO_URING));
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+#else
+  uv_timer_t timer_handle;
+  uv_loop_t loop;
+  int fds[2];
+  int err;
+  int i;
+
+  ASSERT(0 == uv_loop_init(&loop));
+
+  /* Not an error: the loop keeps using the default backend. */
+  err = uv_loop_configure(&loop, UV_LOOP_USE_IO_URING);
+  if (err == UV_ENOSYS) {
+    ASSERT(0 == uv_loop_close(&loop));
+    RETURN_SKIP("io_uring is not available.");
+  }
+  ASSERT(err == 0);
+
+  ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  for (i = 0; i < 2; i++) {
+    ASSERT(0 == uv_pipe_init(&loop, &io_uring_pipes[i], 0));
+    ASSERT(0 == uv_pipe_open(&io_uring_pipes[i], fds[i]));
+    ASSERT(0 == uv_read_start((uv_stream_t*) &io_uring_pipes[i],
+                              io_uring_alloc_cb,
+                              io_uring_read_cb));
+  }
+
+  ASSERT(0 == uv_timer_init(&loop, &timer_handle));
+  ASSERT(0 == uv_timer_start(&timer_handle, io_uring_timer_cb, 10, 0));
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+
+  ASSERT(1 == io_uring_write_cb_called);
+  ASSERT(2 == io_uring_read_cb_called);
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+#endif
+}
+
+
+TEST_IMPL(loop_configure_busy_poll) {
+  uv_timer_t timer_handle;
+  uv_loop_t loop;
+  int err;
+
+  ASSERT(0 == uv_loop_init(&loop));
+
+  err = uv_loop_configure(&loop, UV_LOOP_BUSY_POLL, 1000u);
+  if (err == UV_ENOSYS) {
+    ASSERT(0 == uv_loop_close(&loop));
+    RETURN_SKIP("Busy polling is not supported on this platform.");
+  }
+  ASSERT(err == 0);
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_SOCKET_BUSY_POLL, 50u));
+
+  /* Nothing happens before the timer expires, the whole budget gets spent. */
+  ASSERT(0 == uv_timer_init(&loop, &timer_handle));
+  ASSERT(0 == uv_timer_start(&timer_handle, timer_cb, 10, 0));
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(uv_metrics_busy_poll_time(&loop) >= 1000 * 1000);
+
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
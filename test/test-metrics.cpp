@@ -0,0 +1,191 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#ifndef _WIN32
+# include <sys/socket.h>
+#endif
+
+#define UV_NS_TO_MS 1000000
+
+static int timer_cb_called;
+static int check_cb_called;
+
+
+static void busy_wait(uint64_t ms) {
+  uint64_t start;
+
+  start = uv_hrtime();
+  while (uv_hrtime() - start < ms * UV_NS_TO_MS);
+}
+
+
+static void timer_cb(uv_timer_t* handle) {
+  timer_cb_called++;
+  busy_wait(5);
+  uv_close((uv_handle_t*) handle, nullptr);
+}
+
+
+static void check_cb(uv_check_t* handle) {
+  check_cb_called++;
+  busy_wait(5);
+  uv_close((uv_handle_t*) handle, nullptr);
+}
+
+
+TEST_IMPL(metrics_idle_time) {
+  uv_timer_t timer;
+  uv_loop_t loop;
+  uint64_t idle_time;
+  int err;
+
+  ASSERT(0 == uv_loop_init(&loop));
+
+  err = uv_loop_configure(&loop, UV_LOOP_ENABLE_METRICS);
+  if (err == UV_ENOSYS) {
+    ASSERT(0 == uv_loop_close(&loop));
+    RETURN_SKIP("Loop metrics are not supported on this platform.");
+  }
+  ASSERT(err == 0);
+
+  ASSERT(0 == uv_timer_init(&loop, &timer));
+  ASSERT(0 == uv_timer_start(&timer, timer_cb, 100, 0));
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(timer_cb_called == 1);
+
+  /* The loop is asleep for most of the timeout, allow for some jitter. */
+  idle_time = uv_metrics_idle_time(&loop);
+  ASSERT(idle_time >= 80 * UV_NS_TO_MS);
+  ASSERT(idle_time < 1000 * UV_NS_TO_MS);
+
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+
+TEST_IMPL(metrics_info) {
+  uv_metrics_t metrics;
+  uv_timer_t timer;
+  uv_check_t check;
+  uv_loop_t loop;
+  int err;
+
+  ASSERT(0 == uv_loop_init(&loop));
+
+  err = uv_metrics_info(&loop, &metrics);
+  if (err == UV_ENOSYS) {
+    ASSERT(0 == uv_loop_close(&loop));
+    RETURN_SKIP("Loop metrics are not supported on this platform.");
+  }
+  ASSERT(err == 0);
+  ASSERT(metrics.loop_count == 0);
+  ASSERT(UV_EINVAL == uv_metrics_info(&loop, nullptr));
+
+  /* Counters are kept without UV_LOOP_ENABLE_METRICS, timing is not. */
+  ASSERT(0 == uv_timer_init(&loop, &timer));
+  ASSERT(0 == uv_timer_start(&timer, timer_cb, 10, 0));
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(0 == uv_metrics_info(&loop, &metrics));
+  ASSERT(metrics.loop_count > 0);
+  ASSERT(metrics.event_waits > 0);
+  ASSERT(metrics.idle_time == 0);
+  ASSERT(metrics.phase_time[UV_METRICS_PHASE_TIMERS] == 0);
+
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_ENABLE_METRICS));
+  ASSERT(0 == uv_timer_init(&loop, &timer));
+  ASSERT(0 == uv_timer_start(&timer, timer_cb, 10, 0));
+  ASSERT(0 == uv_check_init(&loop, &check));
+  ASSERT(0 == uv_check_start(&check, check_cb));
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(timer_cb_called == 2);
+  ASSERT(check_cb_called == 1);
+
+  ASSERT(0 == uv_metrics_info(&loop, &metrics));
+  ASSERT(metrics.idle_time > 0);
+  ASSERT(metrics.phase_time[UV_METRICS_PHASE_TIMERS] >= 5 * UV_NS_TO_MS);
+  ASSERT(metrics.phase_time[UV_METRICS_PHASE_CHECK] >= 5 * UV_NS_TO_MS);
+  ASSERT(metrics.phase_time[UV_METRICS_PHASE_IDLE] < 5 * UV_NS_TO_MS);
+
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+}
+
+
+#ifndef _WIN32
+static uv_pipe_t pipes[2];
+static uv_write_t write_req;
+static int read_cb_called;
+
+
+static void alloc_cb(uv_handle_t* handle,
+                     size_t suggested_size,
+                     uv_buf_t* buf) {
+  static char slab[64];
+  buf->base = slab;
+  buf->len = sizeof(slab);
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+  if (nread == 0)
+    return;
+
+  ASSERT(nread == 4);
+  read_cb_called++;
+  uv_close((uv_handle_t*) &pipes[0], nullptr);
+  uv_close((uv_handle_t*) &pipes[1], nullptr);
+}
+#endif
+
+
+TEST_IMPL(metrics_events) {
+#ifdef _WIN32
+  RETURN_SKIP("Loop metrics are not supported on Windows.");
+#else
+  uv_metrics_t metrics;
+  uv_buf_t buf;
+  uv_loop_t loop;
+  int fds[2];
+
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT(0 == uv_pipe_init(&loop, &pipes[0], 0));
+  ASSERT(0 == uv_pipe_open(&pipes[0], fds[0]));
+  ASSERT(0 == uv_pipe_init(&loop, &pipes[1], 0));
+  ASSERT(0 == uv_pipe_open(&pipes[1], fds[1]));
+
+  ASSERT(0 == uv_read_start((uv_stream_t*) &pipes[0], alloc_cb, read_cb));
+  buf = uv_buf_init(const_cast<char*>("PING"), 4);
+  ASSERT(0 == uv_write(&write_req, (uv_stream_t*) &pipes[1], &buf, 1, nullptr));
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(read_cb_called == 1);
+
+  ASSERT(0 == uv_metrics_info(&loop, &metrics));
+  ASSERT(metrics.events > 0);
+  ASSERT(metrics.events <= metrics.event_waits * 1024);
+
+  ASSERT(0 == uv_loop_close(&loop));
+  return 0;
+#endif
+}
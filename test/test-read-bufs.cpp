@@ -0,0 +1,126 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include "uv.h"
+#include "task.h"
+
+#include <string.h>
+
+#ifndef _WIN32
+# include <sys/socket.h>
+# include <unistd.h>
+
+static uv_pipe_t reader;
+static int writer;
+static char header[4];
+static char body[64];
+static int alloc_cb_called;
+static int read_cb_called;
+static int eof_cb_called;
+
+
+static void alloc_bufs_cb(uv_handle_t* handle,
+                          size_t suggested_size,
+                          uv_buf_t bufs[],
+                          unsigned int* nbufs) {
+  ASSERT(*nbufs >= 2);
+  bufs[0] = uv_buf_init(header, sizeof(header));
+  bufs[1] = uv_buf_init(body, sizeof(body));
+  *nbufs = 2;
+  alloc_cb_called++;
+}
+
+
+static void read_bufs_cb(uv_stream_t* stream,
+                         ssize_t nread,
+                         const uv_buf_t bufs[],
+                         unsigned int nbufs) {
+  ASSERT(nbufs == 2);
+  ASSERT(bufs[0].base == header);
+  ASSERT(bufs[1].base == body);
+
+  if (nread == 0)
+    return;
+
+  if (nread == UV_EOF) {
+    eof_cb_called++;
+    uv_close((uv_handle_t*) stream, nullptr);
+    return;
+  }
+
+  switch (read_cb_called++) {
+  case 0:
+    /* One read, the header and the body each land in their own buffer. */
+    ASSERT(nread == 13);
+    ASSERT(bufs[0].len == 4);
+    ASSERT(0 == memcmp(header, "HEAD", 4));
+    ASSERT(bufs[1].len == 9);
+    ASSERT(0 == memcmp(body, "body-data", 9));
+    ASSERT(2 == write(writer, "AB", 2));
+    break;
+
+  case 1:
+    ASSERT(nread == 2);
+    ASSERT(bufs[0].len == 2);
+    ASSERT(0 == memcmp(header, "AB", 2));
+    ASSERT(bufs[1].len == 0);
+    ASSERT(0 == close(writer));
+    break;
+
+  default:
+    ASSERT(0 && "unexpected read");
+  }
+}
+#endif
+
+
+TEST_IMPL(read_bufs) {
+#ifdef _WIN32
+  RETURN_SKIP("Vectored reads are not supported on Windows.");
+#else
+  uv_loop_t* loop;
+  int fds[2];
+
+  loop = uv_default_loop();
+
+  ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT(0 == uv_pipe_init(loop, &reader, 0));
+  ASSERT(0 == uv_pipe_open(&reader, fds[0]));
+  writer = fds[1];
+
+  ASSERT(UV_EINVAL == uv_read_start_bufs((uv_stream_t*) &reader,
+                                         alloc_bufs_cb,
+                                         nullptr));
+  ASSERT(0 == uv_read_start_bufs((uv_stream_t*) &reader,
+                                 alloc_bufs_cb,
+                                 read_bufs_cb));
+
+  ASSERT(13 == write(writer, "HEADbody-data", 13));
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(read_cb_called == 2);
+  ASSERT(eof_cb_called == 1);
+  ASSERT(alloc_cb_called >= 3);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+#endif
+}
@@ -0,0 +1,107 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <string.h>
+
+#ifndef _WIN32
+# include <sys/socket.h>
+# include <unistd.h>
+
+static uv_pipe_t readers[2];
+static int writers[2];
+static uv_buf_t kept;
+static int read_cb_called;
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+  if (nread == 0)
+    return;
+
+  ASSERT(nread == 4);
+  ASSERT(buf->len == 4);
+
+  switch (read_cb_called++) {
+  case 0:
+    /* Hold on to the first slice, the next read goes behind it. */
+    ASSERT(stream == (uv_stream_t*) &readers[0]);
+    ASSERT(0 == memcmp(buf->base, "PING", 4));
+    kept = *buf;
+    uv_read_buf_retain(stream->loop, &kept);
+    ASSERT(4 == write(writers[1], "PONG", 4));
+    break;
+
+  case 1:
+    ASSERT(stream == (uv_stream_t*) &readers[1]);
+    ASSERT(0 == memcmp(buf->base, "PONG", 4));
+    ASSERT(buf->base != kept.base);
+    ASSERT(0 == memcmp(kept.base, "PING", 4));
+    uv_read_buf_release(stream->loop, &kept);
+    ASSERT(4 == write(writers[0], "DONE", 4));
+    break;
+
+  case 2:
+    /* Nothing is held anymore, the streams share the same memory. */
+    ASSERT(stream == (uv_stream_t*) &readers[0]);
+    ASSERT(0 == memcmp(buf->base, "DONE", 4));
+    ASSERT(buf->base == kept.base);
+    uv_close((uv_handle_t*) &readers[0], nullptr);
+    uv_close((uv_handle_t*) &readers[1], nullptr);
+    break;
+
+  default:
+    ASSERT(0 && "unexpected read");
+  }
+}
+#endif
+
+
+TEST_IMPL(read_pooled) {
+#ifdef _WIN32
+  RETURN_SKIP("Pooled reads are not supported on Windows.");
+#else
+  uv_loop_t* loop;
+  int fds[2];
+  int i;
+
+  loop = uv_default_loop();
+
+  for (i = 0; i < 2; i++) {
+    ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    ASSERT(0 == uv_pipe_init(loop, &readers[i], 0));
+    ASSERT(0 == uv_pipe_open(&readers[i], fds[0]));
+    ASSERT(0 == uv_read_start_pooled((uv_stream_t*) &readers[i], read_cb));
+    writers[i] = fds[1];
+  }
+
+  ASSERT(4 == write(writers[0], "PING", 4));
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(read_cb_called == 3);
+
+  ASSERT(0 == close(writers[0]));
+  ASSERT(0 == close(writers[1]));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+#endif
+}
@@ -0,0 +1,127 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <string.h>
+
+#ifndef _WIN32
+# include <errno.h>
+# include <sys/socket.h>
+# include <unistd.h>
+#endif
+
+#define THRESHOLD 64
+
+static uv_pipe_t writer;
+static uv_write_t write_reqs[7];
+static int write_cb_called;
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  ASSERT(req == &write_reqs[write_cb_called]);
+  write_cb_called++;
+}
+
+
+static void write_str(uv_write_t* req, const char* s) {
+  uv_buf_t buf;
+
+  buf = uv_buf_init(const_cast<char*>(s), strlen(s));
+  ASSERT(0 == uv_write(req, (uv_stream_t*) &writer, &buf, 1, write_cb));
+}
+
+
+TEST_IMPL(stream_cork) {
+#ifdef _WIN32
+  RETURN_SKIP("Corked streams are not supported on Windows.");
+#else
+  static char big[THRESHOLD];
+  uv_write_t* req;
+  uv_loop_t* loop;
+  uv_buf_t buf;
+  char data[256];
+  int fds[2];
+  int i;
+
+  loop = uv_default_loop();
+
+  ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  ASSERT(0 == uv_pipe_init(loop, &writer, 0));
+  ASSERT(0 == uv_pipe_open(&writer, fds[0]));
+  ASSERT(0 == uv_stream_set_cork((uv_stream_t*) &writer, 1, THRESHOLD));
+
+  /* Small writes are held back until the loop runs. */
+  req = write_reqs;
+  for (i = 0; i < 4; i++) {
+    buf = uv_buf_init(const_cast<char*>("0123456789abcdef") + 4 * i, 4);
+    ASSERT(0 == uv_write(req++, (uv_stream_t*) &writer, &buf, 1, write_cb));
+  }
+  ASSERT(-1 == recv(fds[1], data, sizeof(data), MSG_DONTWAIT));
+  ASSERT(errno == EAGAIN || errno == EWOULDBLOCK);
+
+  ASSERT(0 == uv_run(loop, UV_RUN_NOWAIT));
+  ASSERT(write_cb_called == 4);
+  ASSERT(16 == recv(fds[1], data, sizeof(data), MSG_DONTWAIT));
+  ASSERT(0 == memcmp(data, "0123456789abcdef", 16));
+
+  /* Reaching the threshold writes everything that was gathered right away,
+   * the callbacks are still made from the loop.
+   */
+  write_str(&write_reqs[4], "gathered");
+  memset(big, 'x', sizeof(big));
+  buf = uv_buf_init(big, sizeof(big));
+  ASSERT(0 == uv_write(&write_reqs[5],
+                       (uv_stream_t*) &writer,
+                       &buf,
+                       1,
+                       write_cb));
+  ASSERT(8 + THRESHOLD == recv(fds[1], data, sizeof(data), MSG_DONTWAIT));
+  ASSERT(0 == memcmp(data, "gathered", 8));
+  ASSERT(write_cb_called == 4);
+
+  ASSERT(0 == uv_run(loop, UV_RUN_NOWAIT));
+  ASSERT(write_cb_called == 6);
+
+  /* uv_try_write() isn't held back. */
+  buf = uv_buf_init(const_cast<char*>("try"), 3);
+  ASSERT(3 == uv_try_write((uv_stream_t*) &writer, &buf, 1));
+  ASSERT(3 == recv(fds[1], data, sizeof(data), MSG_DONTWAIT));
+
+  /* Uncorking flushes what has been gathered. */
+  write_str(&write_reqs[6], "tail");
+  ASSERT(-1 == recv(fds[1], data, sizeof(data), MSG_DONTWAIT));
+  ASSERT(0 == uv_stream_set_cork((uv_stream_t*) &writer, 0, 0));
+  ASSERT(0 == uv_run(loop, UV_RUN_NOWAIT));
+  ASSERT(write_cb_called == 7);
+  ASSERT(4 == recv(fds[1], data, sizeof(data), MSG_DONTWAIT));
+  ASSERT(0 == memcmp(data, "tail", 4));
+
+  uv_close((uv_handle_t*) &writer, nullptr);
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(0 == close(fds[1]));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+#endif
+}
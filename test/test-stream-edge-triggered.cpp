@@ -0,0 +1,122 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <string.h>
+
+#ifndef _WIN32
+# include <sys/socket.h>
+# include <unistd.h>
+#endif
+
+/* Many times the read budget of a single uv__read() call so the stream has to
+ * be fed back to the loop a number of times before it's drained.
+ */
+#define TOTAL_BYTES (256 * 1024)
+
+static uv_pipe_t reader;
+static int writer_fd;
+static size_t bytes_read;
+static int close_cb_called;
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static void alloc_cb(uv_handle_t* handle,
+                     size_t suggested_size,
+                     uv_buf_t* buf) {
+  static char slab[1024];
+  buf->base = slab;
+  buf->len = sizeof(slab);
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+  ASSERT(nread >= 0);
+  bytes_read += nread;
+
+  /* Don't close the write end before everything has been read, the hangup
+   * would generate a new edge and mask a stream that isn't fed back.
+   */
+  if (bytes_read == TOTAL_BYTES)
+    uv_close((uv_handle_t*) stream, close_cb);
+}
+
+
+TEST_IMPL(stream_edge_triggered) {
+#ifdef _WIN32
+  RETURN_SKIP("Edge-triggered streams are not supported on Windows.");
+#else
+  static char data[TOTAL_BYTES];
+  uv_loop_t* loop;
+  ssize_t n;
+  size_t off;
+  int fds[2];
+  int size;
+  int err;
+
+  loop = uv_default_loop();
+
+  ASSERT(0 == socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  size = 2 * TOTAL_BYTES;
+  ASSERT(0 == setsockopt(fds[0], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)));
+  ASSERT(0 == setsockopt(fds[1], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)));
+  writer_fd = fds[1];
+
+  ASSERT(0 == uv_pipe_init(loop, &reader, 0));
+  ASSERT(0 == uv_pipe_open(&reader, fds[0]));
+
+  err = uv_stream_set_edge_triggered((uv_stream_t*) &reader, 1);
+  if (err == UV_ENOTSUP) {
+    uv_close((uv_handle_t*) &reader, nullptr);
+    uv_run(loop, UV_RUN_DEFAULT);
+    ASSERT(0 == close(writer_fd));
+    RETURN_SKIP("Edge-triggered streams are not supported on this platform.");
+  }
+  ASSERT(err == 0);
+
+  /* Fill the socket buffer before reading starts, there is only one edge. */
+  memset(data, 'x', sizeof(data));
+  for (off = 0; off < sizeof(data); off += n) {
+    n = write(writer_fd, data + off, sizeof(data) - off);
+    ASSERT(n > 0);
+  }
+
+  ASSERT(0 == uv_read_start((uv_stream_t*) &reader, alloc_cb, read_cb));
+
+  /* The trigger mode can't change while the stream is active. */
+  ASSERT(UV_EBUSY == uv_stream_set_edge_triggered((uv_stream_t*) &reader, 0));
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+
+  ASSERT(bytes_read == TOTAL_BYTES);
+  ASSERT(close_cb_called == 1);
+  ASSERT(0 == close(writer_fd));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+#endif
+}
@@ -0,0 +1,167 @@
+/* Copyright libuv project contributors. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "uv.h"
+#include "task.h"
+
+#include <string.h>
+
+#define BIG_SIZE (1024 * 1024)
+#define SMALL_SIZE 16
+#define THRESHOLD (64 * 1024)
+
+static uv_tcp_t server;
+static uv_tcp_t client;
+static uv_tcp_t incoming;
+static uv_connect_t connect_req;
+static uv_shutdown_t shutdown_req;
+static uv_write_t write_reqs[3];
+static char big[BIG_SIZE];
+static char small[SMALL_SIZE];
+static size_t bytes_read;
+static int write_cb_called;
+static int shutdown_cb_called;
+static int close_cb_called;
+
+
+static char expected_byte(size_t offset) {
+  /* Two big writes with a small one in between. */
+  if (offset < BIG_SIZE)
+    return big[offset];
+  offset -= BIG_SIZE;
+  if (offset < SMALL_SIZE)
+    return small[offset];
+  return big[offset - SMALL_SIZE];
+}
+
+
+static void close_cb(uv_handle_t* handle) {
+  close_cb_called++;
+}
+
+
+static void alloc_cb(uv_handle_t* handle, size_t size, uv_buf_t* buf) {
+  static char slab[65536];
+
+  buf->base = slab;
+  buf->len = sizeof(slab);
+}
+
+
+static void read_cb(uv_stream_t* stream, ssize_t nread, const uv_buf_t* buf) {
+  ssize_t i;
+
+  if (nread == UV_EOF) {
+    ASSERT(bytes_read == 2 * BIG_SIZE + SMALL_SIZE);
+    uv_close((uv_handle_t*) stream, close_cb);
+    uv_close((uv_handle_t*) &server, close_cb);
+    return;
+  }
+
+  ASSERT(nread >= 0);
+  for (i = 0; i < nread; i++)
+    ASSERT(buf->base[i] == expected_byte(bytes_read + i));
+  bytes_read += nread;
+}
+
+
+static void connection_cb(uv_stream_t* handle, int status) {
+  ASSERT(status == 0);
+  ASSERT(0 == uv_tcp_init(handle->loop, &incoming));
+  ASSERT(0 == uv_accept(handle, (uv_stream_t*) &incoming));
+  ASSERT(0 == uv_read_start((uv_stream_t*) &incoming, alloc_cb, read_cb));
+}
+
+
+static void write_cb(uv_write_t* req, int status) {
+  ASSERT(status == 0);
+  /* In order, although only the big writes wait for the kernel. */
+  ASSERT(req == &write_reqs[write_cb_called]);
+  write_cb_called++;
+}
+
+
+static void shutdown_cb(uv_shutdown_t* req, int status) {
+  ASSERT(status == 0);
+  ASSERT(write_cb_called == 3);
+  shutdown_cb_called++;
+  uv_close((uv_handle_t*) &client, close_cb);
+}
+
+
+static void connect_cb(uv_connect_t* req, int status) {
+  uv_buf_t buf;
+
+  ASSERT(status == 0);
+  ASSERT(0 == uv_tcp_zerocopy(&client, 1, THRESHOLD));
+
+  buf = uv_buf_init(big, sizeof(big));
+  ASSERT(0 == uv_write(&write_reqs[0], req->handle, &buf, 1, write_cb));
+  buf = uv_buf_init(small, sizeof(small));
+  ASSERT(0 == uv_write(&write_reqs[1], req->handle, &buf, 1, write_cb));
+  buf = uv_buf_init(big, sizeof(big));
+  ASSERT(0 == uv_write(&write_reqs[2], req->handle, &buf, 1, write_cb));
+
+  ASSERT(0 == uv_shutdown(&shutdown_req, req->handle, shutdown_cb));
+}
+
+
+TEST_IMPL(tcp_zerocopy) {
+  struct sockaddr_in addr;
+  uv_loop_t* loop;
+  size_t i;
+  int r;
+
+  loop = uv_default_loop();
+  ASSERT(0 == uv_tcp_init(loop, &client));
+
+  r = uv_tcp_zerocopy(&client, 1, THRESHOLD);
+  if (r == UV_ENOTSUP) {
+    uv_close((uv_handle_t*) &client, nullptr);
+    uv_run(loop, UV_RUN_DEFAULT);
+    MAKE_VALGRIND_HAPPY();
+    RETURN_SKIP("Zero-copy writes are not supported on this platform.");
+  }
+  ASSERT(r == 0);
+
+  for (i = 0; i < sizeof(big); i++)
+    big[i] = 'a' + i % 26;
+  memset(small, 'Z', sizeof(small));
+
+  ASSERT(0 == uv_ip4_addr("127.0.0.1", TEST_PORT, &addr));
+  ASSERT(0 == uv_tcp_init(loop, &server));
+  ASSERT(0 == uv_tcp_bind(&server, (const struct sockaddr*) &addr, 0));
+  ASSERT(0 == uv_listen((uv_stream_t*) &server, 128, connection_cb));
+
+  ASSERT(0 == uv_tcp_connect(&connect_req,
+                             &client,
+                             (const struct sockaddr*) &addr,
+                             connect_cb));
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+
+  ASSERT(write_cb_called == 3);
+  ASSERT(shutdown_cb_called == 1);
+  ASSERT(close_cb_called == 3);
+  ASSERT(bytes_read == 2 * BIG_SIZE + SMALL_SIZE);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
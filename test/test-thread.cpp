@@ -284,3 +284,53 @@ TEST_IMPL(thread_stack_size_explicit) {
 
   return 0;
 }
+
+static void thread_check_cpu(void* arg) {
+  ASSERT(uv_thread_getcpu() == *(int*) arg);
+}
+
+
+TEST_IMPL(thread_affinity) {
+  uv_thread_options_t options;
+  uv_thread_t thread;
+  char* cpumask;
+  char* oldmask;
+  int size;
+  int cpu;
+
+  size = uv_cpumask_size();
+  if (size == UV_ENOTSUP)
+    RETURN_SKIP("Thread affinity is not supported on this platform.");
+  ASSERT(size > 0);
+
+  cpu = uv_thread_getcpu();
+  ASSERT(cpu >= 0);
+  ASSERT(cpu < size);
+
+  cpumask = (char*) calloc(size, 1);
+  oldmask = (char*) calloc(size, 1);
+  ASSERT(cpumask != nullptr);
+  ASSERT(oldmask != nullptr);
+  cpumask[cpu] = 1;
+
+  options.flags = UV_THREAD_HAS_AFFINITY;
+  options.cpumask = cpumask;
+  options.mask_size = size - 1;
+  ASSERT(UV_EINVAL == uv_thread_create_ex(&thread, &options,
+                                          thread_check_cpu, &cpu));
+
+  options.mask_size = size;
+  ASSERT(0 == uv_thread_create_ex(&thread, &options, thread_check_cpu, &cpu));
+  ASSERT(0 == uv_thread_join(&thread));
+
+  /* Pin the current thread and put it back. */
+  thread = uv_thread_self();
+  ASSERT(0 == uv_thread_setaffinity(&thread, cpumask, oldmask, size));
+  ASSERT(uv_thread_getcpu() == cpu);
+  ASSERT(oldmask[cpu] == 1);
+  ASSERT(0 == uv_thread_setaffinity(&thread, oldmask, nullptr, size));
+
+  free(cpumask);
+  free(oldmask);
+  return 0;
+}
@@ -254,6 +254,7 @@ TEST_IMPL(threadpool_cancel_random) {
 
 
 TEST_IMPL(threadpool_cancel_work) {
+  uv_threadpool_metrics_t metrics;
   struct cancel_info ci;
   uv_work_t reqs[16];
   uv_loop_t* loop;
@@ -272,6 +273,10 @@ TEST_IMPL(threadpool_cancel_work) {
   ASSERT(1 == timer_cb_called);
   ASSERT(ARRAY_SIZE(reqs) == done2_cb_called);
 
+  ASSERT(0 == uv_threadpool_metrics_info(uv_default_threadpool(), &metrics));
+  ASSERT(ARRAY_SIZE(reqs) == metrics.cancelled);
+  ASSERT(0 == metrics.cancel_races);
+
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
@@ -332,6 +337,7 @@ TEST_IMPL(threadpool_cancel_fs) {
 
 
 TEST_IMPL(threadpool_cancel_single) {
+  uv_threadpool_metrics_t metrics;
   uv_loop_t* loop;
   uv_work_t req;
 
@@ -339,7 +345,21 @@ TEST_IMPL(threadpool_cancel_single) {
   loop = uv_default_loop();
   ASSERT(0 == uv_queue_work(loop, &req, (uv_work_cb) abort, nop_done_cb));
   ASSERT(0 == uv_cancel((uv_req_t*) &req));
+  ASSERT(UV_EBUSY == uv_cancel((uv_req_t*) &req));
   ASSERT(0 == done_cb_called);
+
+  /* Work that has started can't be cancelled anymore. */
+  for (;;) {
+    ASSERT(0 == uv_threadpool_metrics_info(uv_default_threadpool(), &metrics));
+    if (metrics.queued == 0)
+      break;
+    uv_sleep(1);
+  }
+  ASSERT(UV_EBUSY == uv_cancel((uv_req_t*) &pause_reqs[0]));
+
+  ASSERT(0 == uv_threadpool_metrics_info(uv_default_threadpool(), &metrics));
+  ASSERT(1 == metrics.cancelled);
+  ASSERT(1 == metrics.cancel_races);
   unblock_threadpool();
   ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
   ASSERT(1 == done_cb_called);
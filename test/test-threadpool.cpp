@@ -22,11 +22,22 @@
 #include "uv.h"
 #include "task.h"
 
+#define NUM_BURST_REQS 1024
+
 static int work_cb_count;
 static int after_work_cb_count;
 static uv_work_t work_req;
 static char data;
 
+static uv_work_t burst_reqs[NUM_BURST_REQS];
+static uv_mutex_t burst_mutex;
+static int burst_work_cb_count;
+static int burst_after_work_cb_count;
+static int order_next;
+
+static uv_sem_t block_sem;
+static uv_sem_t started_sem;
+
 
 static void work_cb(uv_work_t* req) {
   ASSERT(req == &work_req);
@@ -74,3 +85,621 @@ TEST_IMPL(threadpool_queue_work_einval) {
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+static void burst_work_cb(uv_work_t* req) {
+  uv_mutex_lock(&burst_mutex);
+  burst_work_cb_count++;
+  uv_mutex_unlock(&burst_mutex);
+}
+
+
+static void burst_after_work_cb(uv_work_t* req, int status) {
+  ASSERT(status == 0);
+  burst_after_work_cb_count++;
+}
+
+
+TEST_IMPL(threadpool_queue_work_burst) {
+  uv_loop_t* loop;
+  int i;
+
+  ASSERT(0 == uv_mutex_init(&burst_mutex));
+  loop = uv_default_loop();
+
+  /* Submit faster than the threads can pick it up, every request must run
+   * exactly once however it's distributed over the threads.
+   */
+  for (i = 0; i < NUM_BURST_REQS; i++)
+    ASSERT(0 == uv_queue_work(loop,
+                              &burst_reqs[i],
+                              burst_work_cb,
+                              burst_after_work_cb));
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(burst_work_cb_count == NUM_BURST_REQS);
+  ASSERT(burst_after_work_cb_count == NUM_BURST_REQS);
+
+  uv_mutex_destroy(&burst_mutex);
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static int batch_cb_count;
+
+
+static void batch_cb(uv_work_t* reqs, unsigned int nreqs) {
+  ASSERT(reqs == burst_reqs);
+  ASSERT(nreqs == NUM_BURST_REQS);
+  ASSERT(burst_after_work_cb_count == NUM_BURST_REQS);
+  batch_cb_count++;
+}
+
+
+TEST_IMPL(threadpool_queue_work_batch) {
+  uv_loop_t* loop;
+
+  ASSERT(0 == uv_mutex_init(&burst_mutex));
+  loop = uv_default_loop();
+
+  ASSERT(UV_EINVAL == uv_queue_work_batch(loop,
+                                          burst_reqs,
+                                          0,
+                                          burst_work_cb,
+                                          nullptr,
+                                          batch_cb));
+  ASSERT(UV_EINVAL == uv_queue_work_batch(loop,
+                                          burst_reqs,
+                                          NUM_BURST_REQS,
+                                          nullptr,
+                                          nullptr,
+                                          batch_cb));
+
+  /* Every request gets its own callback, the batch callback runs once after
+   * the last one.
+   */
+  ASSERT(0 == uv_queue_work_batch(loop,
+                                  burst_reqs,
+                                  NUM_BURST_REQS,
+                                  burst_work_cb,
+                                  burst_after_work_cb,
+                                  batch_cb));
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(burst_work_cb_count == NUM_BURST_REQS);
+  ASSERT(burst_after_work_cb_count == NUM_BURST_REQS);
+  ASSERT(batch_cb_count == 1);
+
+  uv_mutex_destroy(&burst_mutex);
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static void order_work_cb(uv_work_t* req) {
+  /* Give the loop a chance to pick up the completed ones in between. */
+  if ((req - burst_reqs) % 16 == 0)
+    uv_sleep(1);
+}
+
+
+static void order_after_work_cb(uv_work_t* req, int status) {
+  ASSERT(status == 0);
+  ASSERT(req == &burst_reqs[order_next]);
+  order_next++;
+}
+
+
+TEST_IMPL(threadpool_queue_work_order) {
+  uv_loop_t* loop;
+  int i;
+
+  /* With one thread the work completes in the order in which it was queued,
+   * the callbacks must run in that order too.
+   */
+  ASSERT(0 == putenv(const_cast<char*>("UV_THREADPOOL_SIZE=1")));
+  loop = uv_default_loop();
+
+  for (i = 0; i < NUM_BURST_REQS; i++)
+    ASSERT(0 == uv_queue_work(loop,
+                              &burst_reqs[i],
+                              order_work_cb,
+                              order_after_work_cb));
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(order_next == NUM_BURST_REQS);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static void block_work_cb(uv_work_t* req) {
+  uv_sem_post(&started_sem);
+  uv_sem_wait(&block_sem);
+}
+
+
+TEST_IMPL(threadpool_set_size) {
+  uv_threadpool_t* pool;
+  uv_loop_t* loop;
+  int i;
+
+  pool = uv_default_threadpool();
+  ASSERT(UV_EINVAL == uv_threadpool_set_size(pool, 0, 4));
+  ASSERT(UV_EINVAL == uv_threadpool_set_size(pool, 4, 2));
+  ASSERT(UV_EINVAL == uv_threadpool_set_size(pool, 1, 1025));
+
+  ASSERT(0 == uv_mutex_init(&burst_mutex));
+  ASSERT(0 == uv_sem_init(&block_sem, 0));
+  ASSERT(0 == uv_sem_init(&started_sem, 0));
+  loop = uv_default_loop();
+
+  /* Shrink to one thread, then let the pool grow again. All four requests
+   * block, they can only all start if threads are added.
+   */
+  ASSERT(0 == uv_threadpool_set_size(pool, 1, 1));
+  ASSERT(0 == uv_threadpool_set_size(pool, 1, 4));
+
+  for (i = 0; i < 4; i++)
+    ASSERT(0 == uv_queue_work(loop,
+                              &burst_reqs[i],
+                              block_work_cb,
+                              burst_after_work_cb));
+
+  for (i = 0; i < 4; i++)
+    uv_sem_wait(&started_sem);
+
+  for (i = 0; i < 4; i++)
+    uv_sem_post(&block_sem);
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(burst_after_work_cb_count == 4);
+
+  /* The threads that were added exit, work still gets done. */
+  ASSERT(0 == uv_threadpool_set_size(pool, 1, 1));
+  ASSERT(0 == uv_queue_work(loop,
+                            &burst_reqs[4],
+                            burst_work_cb,
+                            burst_after_work_cb));
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(burst_after_work_cb_count == 5);
+
+  uv_mutex_destroy(&burst_mutex);
+  uv_sem_destroy(&block_sem);
+  uv_sem_destroy(&started_sem);
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+TEST_IMPL(threadpool_instances) {
+  uv_threadpool_t pool;
+  uv_loop_t loop;
+
+  ASSERT(UV_EINVAL == uv_threadpool_init(&pool, 2, 1));
+  ASSERT(UV_EINVAL == uv_threadpool_close(uv_default_threadpool()));
+
+  ASSERT(0 == uv_mutex_init(&burst_mutex));
+  ASSERT(0 == uv_sem_init(&block_sem, 0));
+  ASSERT(0 == uv_sem_init(&started_sem, 0));
+
+  /* Tie up the only thread of the default pool. */
+  ASSERT(0 == uv_threadpool_set_size(uv_default_threadpool(), 1, 1));
+  ASSERT(0 == uv_queue_work(uv_default_loop(),
+                            &burst_reqs[0],
+                            block_work_cb,
+                            burst_after_work_cb));
+  uv_sem_wait(&started_sem);
+
+  /* Work on a loop with a pool of its own still gets done. */
+  ASSERT(0 == uv_threadpool_init(&pool, 1, 1));
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_THREADPOOL, &pool));
+  ASSERT(0 == uv_queue_work(&loop,
+                            &burst_reqs[1],
+                            burst_work_cb,
+                            burst_after_work_cb));
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(burst_after_work_cb_count == 1);
+
+  uv_sem_post(&block_sem);
+  ASSERT(0 == uv_run(uv_default_loop(), UV_RUN_DEFAULT));
+  ASSERT(burst_after_work_cb_count == 2);
+
+  ASSERT(0 == uv_threadpool_close(&pool));
+  ASSERT(0 == uv_loop_close(&loop));
+
+  uv_mutex_destroy(&burst_mutex);
+  uv_sem_destroy(&block_sem);
+  uv_sem_destroy(&started_sem);
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static uv_work_t priority_reqs[12];
+static uv_work_t* priority_order[12];
+static int priority_next;
+
+
+static void priority_work_cb(uv_work_t* req) {
+  priority_order[priority_next++] = req;
+}
+
+
+static void priority_after_work_cb(uv_work_t* req, int status) {
+  ASSERT(status == 0);
+}
+
+
+TEST_IMPL(threadpool_priority) {
+  uv_threadpool_t pool;
+  uv_loop_t* loop;
+  int i;
+
+  loop = uv_default_loop();
+  ASSERT(UV_EINVAL == uv_loop_configure(loop, UV_LOOP_WORK_PRIORITY, 42));
+
+  ASSERT(0 == uv_sem_init(&block_sem, 0));
+  ASSERT(0 == uv_sem_init(&started_sem, 0));
+
+  /* With the only thread busy, queue four requests of every class, lowest
+   * priority first.
+   */
+  ASSERT(0 == uv_threadpool_init(&pool, 1, 1));
+  ASSERT(0 == uv_loop_configure(loop, UV_LOOP_THREADPOOL, &pool));
+  ASSERT(0 == uv_queue_work(loop,
+                            &burst_reqs[0],
+                            block_work_cb,
+                            burst_after_work_cb));
+  uv_sem_wait(&started_sem);
+
+  ASSERT(0 == uv_loop_configure(loop,
+                                UV_LOOP_WORK_PRIORITY,
+                                UV_WORK_PRIORITY_LOW));
+  for (i = 0; i < 4; i++)
+    ASSERT(0 == uv_queue_work(loop,
+                              &priority_reqs[i],
+                              priority_work_cb,
+                              priority_after_work_cb));
+
+  ASSERT(0 == uv_loop_configure(loop,
+                                UV_LOOP_WORK_PRIORITY,
+                                UV_WORK_PRIORITY_NORMAL));
+  for (i = 4; i < 8; i++)
+    ASSERT(0 == uv_queue_work(loop,
+                              &priority_reqs[i],
+                              priority_work_cb,
+                              priority_after_work_cb));
+
+  ASSERT(0 == uv_loop_configure(loop,
+                                UV_LOOP_WORK_PRIORITY,
+                                UV_WORK_PRIORITY_HIGH));
+  ASSERT(0 == uv_queue_work_batch(loop,
+                                  &priority_reqs[8],
+                                  4,
+                                  priority_work_cb,
+                                  priority_after_work_cb,
+                                  nullptr));
+
+  uv_sem_post(&block_sem);
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(priority_next == 12);
+
+  /* High priority work runs first and in order, low priority work is not
+   * held back until everything else is done.
+   */
+  for (i = 0; i < 4; i++)
+    ASSERT(priority_order[i] == &priority_reqs[8 + i]);
+
+  for (i = 4; i < 11; i++)
+    if (priority_order[i] < &priority_reqs[4])
+      break;
+  ASSERT(i < 11);
+
+  ASSERT(0 == uv_loop_configure(loop,
+                                UV_LOOP_WORK_PRIORITY,
+                                UV_WORK_PRIORITY_NORMAL));
+  ASSERT(0 == uv_loop_configure(loop, UV_LOOP_THREADPOOL, nullptr));
+  ASSERT(0 == uv_threadpool_close(&pool));
+  uv_sem_destroy(&block_sem);
+  uv_sem_destroy(&started_sem);
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static void sleep_work_cb(uv_work_t* req) {
+  uv_sleep(2);
+}
+
+
+static void stat_cb(uv_fs_t* req) {
+  ASSERT(req->result == 0);
+  uv_fs_req_cleanup(req);
+}
+
+
+TEST_IMPL(threadpool_metrics) {
+  uv_threadpool_metrics_t metrics;
+  uv_threadpool_t pool;
+  uv_fs_t stat_req;
+  uv_loop_t loop;
+  uint64_t count;
+  int i;
+  int err;
+
+  ASSERT(0 == uv_loop_init(&loop));
+
+  /* Work is only timed for loops that have metrics enabled. */
+  err = uv_loop_configure(&loop, UV_LOOP_ENABLE_METRICS);
+  if (err == UV_ENOSYS) {
+    ASSERT(0 == uv_loop_close(&loop));
+    RETURN_SKIP("Loop metrics are not supported on this platform.");
+  }
+  ASSERT(err == 0);
+
+  ASSERT(0 == uv_sem_init(&block_sem, 0));
+  ASSERT(0 == uv_sem_init(&started_sem, 0));
+  ASSERT(0 == uv_threadpool_init(&pool, 1, 1));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_THREADPOOL, &pool));
+
+  ASSERT(UV_EINVAL == uv_threadpool_metrics_info(&pool, nullptr));
+  ASSERT(0 == uv_threadpool_metrics_info(&pool, &metrics));
+  ASSERT(metrics.threads == 1);
+  ASSERT(metrics.queued == 0);
+
+  /* Work that is waiting for the only thread shows up in the queue depth. */
+  ASSERT(0 == uv_queue_work(&loop,
+                            &burst_reqs[0],
+                            block_work_cb,
+                            burst_after_work_cb));
+  uv_sem_wait(&started_sem);
+
+  for (i = 1; i < 4; i++)
+    ASSERT(0 == uv_queue_work(&loop,
+                              &burst_reqs[i],
+                              sleep_work_cb,
+                              burst_after_work_cb));
+  ASSERT(0 == uv_fs_stat(&loop, &stat_req, ".", stat_cb));
+
+  ASSERT(0 == uv_threadpool_metrics_info(&pool, &metrics));
+  ASSERT(metrics.queued == 4);
+  ASSERT(metrics.idle_threads == 0);
+
+  uv_sem_post(&block_sem);
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+
+  ASSERT(0 == uv_threadpool_metrics_info(&pool, &metrics));
+  ASSERT(metrics.queued == 0);
+
+  count = 0;
+  for (i = 0; i < UV_THREADPOOL_HISTOGRAM_SIZE; i++)
+    count += metrics.wait_time[UV_THREADPOOL_WORK_CPU][i];
+  ASSERT(count == 4);
+
+  /* The sleeping requests ran for at least 2 ms, bucket 11 starts at
+   * 1024 microseconds.
+   */
+  count = 0;
+  for (i = 11; i < UV_THREADPOOL_HISTOGRAM_SIZE; i++)
+    count += metrics.run_time[UV_THREADPOOL_WORK_CPU][i];
+  ASSERT(count >= 3);
+
+  count = 0;
+  for (i = 0; i < UV_THREADPOOL_HISTOGRAM_SIZE; i++)
+    count += metrics.run_time[UV_THREADPOOL_WORK_FAST_IO][i];
+  ASSERT(count == 1);
+
+  ASSERT(0 == uv_loop_close(&loop));
+  ASSERT(0 == uv_threadpool_close(&pool));
+  uv_sem_destroy(&block_sem);
+  uv_sem_destroy(&started_sem);
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static int affinity_cpu;
+static int affinity_mismatches;
+
+
+static void affinity_work_cb(uv_work_t* req) {
+  if (uv_thread_getcpu() != affinity_cpu)
+    affinity_mismatches++;
+}
+
+
+TEST_IMPL(threadpool_affinity) {
+  uv_threadpool_t pool;
+  uv_loop_t loop;
+  char* cpumask;
+  int size;
+  int i;
+
+  size = uv_cpumask_size();
+  if (size == UV_ENOTSUP)
+    RETURN_SKIP("Thread affinity is not supported on this platform.");
+  ASSERT(size > 0);
+
+  affinity_cpu = uv_thread_getcpu();
+  ASSERT(affinity_cpu >= 0);
+
+  cpumask = (char*) calloc(size, 1);
+  ASSERT(cpumask != nullptr);
+
+  ASSERT(0 == uv_threadpool_init(&pool, 2, 2));
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_THREADPOOL, &pool));
+
+  /* An empty mask leaves no CPU to run on. */
+  ASSERT(UV_EINVAL == uv_threadpool_set_affinity(&pool, cpumask, size, 0));
+  ASSERT(UV_EINVAL == uv_threadpool_set_affinity(&pool, cpumask, size - 1, 0));
+
+  /* The threads that are already running move as well. */
+  cpumask[affinity_cpu] = 1;
+  ASSERT(0 == uv_threadpool_set_affinity(&pool,
+                                         cpumask,
+                                         size,
+                                         UV_THREADPOOL_PER_NUMA_NODE));
+
+  /* Grow the pool, the new threads are pinned too. */
+  ASSERT(0 == uv_threadpool_set_size(&pool, 4, 4));
+
+  for (i = 0; i < 64; i++)
+    ASSERT(0 == uv_queue_work(&loop,
+                              &burst_reqs[i],
+                              affinity_work_cb,
+                              burst_after_work_cb));
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(burst_after_work_cb_count == 64);
+  ASSERT(affinity_mismatches == 0);
+
+  /* Without a mask the threads are only grouped per NUMA node. */
+  ASSERT(0 == uv_threadpool_set_affinity(&pool,
+                                         nullptr,
+                                         0,
+                                         UV_THREADPOOL_PER_NUMA_NODE));
+  ASSERT(0 == uv_queue_work(&loop,
+                            &burst_reqs[0],
+                            affinity_work_cb,
+                            burst_after_work_cb));
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(burst_after_work_cb_count == 65);
+
+  ASSERT(0 == uv_loop_close(&loop));
+  ASSERT(0 == uv_threadpool_close(&pool));
+  free(cpumask);
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static uv_sem_t chunk_sem;
+static uv_sem_t blocker_sem;
+static int chunk_order[8];
+static int chunk_events;
+static int chunk_slices;
+static int chunk_progress_cb_count;
+static int chunk_after_work_status;
+static int short_after_work_cb_count;
+
+
+static int chunk_cb(uv_work_t* req) {
+  /* Wait for the test to queue the other work behind the first slice. */
+  if (chunk_slices == 0)
+    uv_sem_wait(&chunk_sem);
+
+  chunk_order[chunk_events++] = 1;
+  return ++chunk_slices < 3;
+}
+
+
+static void chunk_progress_cb(uv_work_t* req) {
+  chunk_progress_cb_count++;
+}
+
+
+static void chunk_after_work_cb(uv_work_t* req, int status) {
+  chunk_after_work_status = status;
+}
+
+
+static void short_work_cb(uv_work_t* req) {
+  chunk_order[chunk_events++] = 2;
+}
+
+
+static void short_after_work_cb(uv_work_t* req, int status) {
+  ASSERT(status == 0);
+  short_after_work_cb_count++;
+}
+
+
+static void blocker_work_cb(uv_work_t* req) {
+  uv_sem_wait(&blocker_sem);
+}
+
+
+static void cancel_progress_cb(uv_work_t* req) {
+  chunk_progress_cb_count++;
+  ASSERT(0 == uv_cancel((uv_req_t*) req));
+  uv_sem_post(&blocker_sem);
+}
+
+
+TEST_IMPL(threadpool_queue_work_chunked) {
+  uv_threadpool_t pool;
+  uv_work_t short_req;
+  uv_work_t req;
+  uv_loop_t loop;
+
+  ASSERT(0 == uv_sem_init(&chunk_sem, 0));
+  ASSERT(0 == uv_sem_init(&blocker_sem, 0));
+  ASSERT(0 == uv_threadpool_init(&pool, 1, 1));
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_THREADPOOL, &pool));
+
+  ASSERT(UV_EINVAL == uv_queue_work_chunked(&loop,
+                                            &req,
+                                            nullptr,
+                                            nullptr,
+                                            nullptr));
+
+  /* The short work was queued while the first slice ran, it goes before the
+   * second one.
+   */
+  ASSERT(0 == uv_queue_work_chunked(&loop,
+                                    &req,
+                                    chunk_cb,
+                                    chunk_progress_cb,
+                                    chunk_after_work_cb));
+  ASSERT(0 == uv_queue_work(&loop,
+                            &short_req,
+                            short_work_cb,
+                            short_after_work_cb));
+  uv_sem_post(&chunk_sem);
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+
+  ASSERT(chunk_slices == 3);
+  ASSERT(chunk_events == 4);
+  ASSERT(chunk_order[0] == 1);
+  ASSERT(chunk_order[1] == 2);
+  ASSERT(chunk_order[2] == 1);
+  ASSERT(chunk_order[3] == 1);
+  ASSERT(short_after_work_cb_count == 1);
+  ASSERT(chunk_after_work_status == 0);
+  ASSERT(chunk_progress_cb_count >= 1);
+  ASSERT(chunk_progress_cb_count <= 2);
+
+  /* Work can be cancelled while it waits for its next slice. */
+  chunk_slices = 0;
+  chunk_events = 0;
+  chunk_progress_cb_count = 0;
+  ASSERT(0 == uv_queue_work_chunked(&loop,
+                                    &req,
+                                    chunk_cb,
+                                    cancel_progress_cb,
+                                    chunk_after_work_cb));
+  ASSERT(0 == uv_queue_work(&loop,
+                            &short_req,
+                            blocker_work_cb,
+                            short_after_work_cb));
+  uv_sem_post(&chunk_sem);
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+
+  ASSERT(chunk_slices == 1);
+  ASSERT(chunk_progress_cb_count == 1);
+  ASSERT(chunk_after_work_status == UV_ECANCELED);
+  ASSERT(short_after_work_cb_count == 2);
+
+  ASSERT(0 == uv_loop_close(&loop));
+  ASSERT(0 == uv_threadpool_close(&pool));
+  uv_sem_destroy(&chunk_sem);
+  uv_sem_destroy(&blocker_sem);
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
@@ -341,3 +341,244 @@ TEST_IMPL(timer_early_check) {
   MAKE_VALGRIND_HAPPY();
   return 0;
 }
+
+
+#define WHEEL_TIMERS 64
+
+static uv_timer_t wheel_timers[WHEEL_TIMERS];
+static uv_timer_t wheel_late_timer;
+static uint64_t wheel_last_timeout;
+static uint64_t wheel_last_start_id;
+static int wheel_cb_called;
+
+
+static void wheel_cb(uv_timer_t* handle) {
+  /* Same order as the heap: by timeout, then by start order. */
+  ASSERT(handle->timeout >= wheel_last_timeout);
+  if (handle->timeout == wheel_last_timeout)
+    ASSERT(handle->start_id > wheel_last_start_id);
+
+  wheel_last_timeout = handle->timeout;
+  wheel_last_start_id = handle->start_id;
+  wheel_cb_called++;
+}
+
+
+static void wheel_trigger_cb(uv_timer_t* handle) {
+  uv_loop_t* loop;
+
+  wheel_cb(handle);
+
+  /* Due at the same time as a timer that was started long before and still
+   * has to come down from the upper level of the wheel.
+   */
+  loop = handle->loop;
+  ASSERT(0 == uv_timer_start(&wheel_late_timer,
+                             wheel_cb,
+                             wheel_timers[0].timeout - uv_now(loop),
+                             0));
+  ASSERT(wheel_late_timer.timeout == wheel_timers[0].timeout);
+}
+
+
+TEST_IMPL(timer_wheel) {
+  uv_timer_t heap_timer;
+  uv_loop_t loop;
+  int i;
+
+  /* The backend can't change while there are timers. */
+  ASSERT(0 == uv_loop_init(&loop));
+  ASSERT(0 == uv_timer_init(&loop, &heap_timer));
+  ASSERT(0 == uv_timer_start(&heap_timer, wheel_cb, 1000, 0));
+  ASSERT(UV_EBUSY == uv_loop_configure(&loop, UV_LOOP_TIMER_WHEEL));
+  ASSERT(0 == uv_timer_stop(&heap_timer));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_TIMER_WHEEL));
+  ASSERT(0 == uv_loop_configure(&loop, UV_LOOP_TIMER_WHEEL));
+
+  ASSERT(0 == uv_timer_init(&loop, &wheel_late_timer));
+  for (i = 0; i < WHEEL_TIMERS; i++)
+    ASSERT(0 == uv_timer_init(&loop, &wheel_timers[i]));
+
+  /* Level 0 and level 1 timers, a few of them share a timeout. */
+  ASSERT(0 == uv_timer_start(&wheel_timers[0], wheel_cb, 500, 0));
+  ASSERT(0 == uv_timer_start(&wheel_timers[1], wheel_trigger_cb, 400, 0));
+  for (i = 2; i < WHEEL_TIMERS; i++)
+    ASSERT(0 == uv_timer_start(&wheel_timers[i], wheel_cb, (i * 37) % 600, 0));
+
+  /* Stopping and restarting is O(1) and keeps the order intact. */
+  ASSERT(0 == uv_timer_stop(&wheel_timers[2]));
+  ASSERT(0 == uv_timer_start(&wheel_timers[2], wheel_cb, 500, 0));
+  ASSERT(0 == uv_timer_stop(&wheel_timers[3]));
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(wheel_cb_called == WHEEL_TIMERS);
+
+  /* Far away timers wake up the loop early, but never late. */
+  ASSERT(0 == uv_timer_start(&wheel_timers[0], wheel_cb, 3600 * 1000, 0));
+  ASSERT(uv_backend_timeout(&loop) > 0);
+  ASSERT(uv_backend_timeout(&loop) <= 3600 * 1000);
+
+  uv_close((uv_handle_t*) &heap_timer, nullptr);
+  uv_close((uv_handle_t*) &wheel_late_timer, nullptr);
+  for (i = 0; i < WHEEL_TIMERS; i++)
+    uv_close((uv_handle_t*) &wheel_timers[i], nullptr);
+
+  ASSERT(0 == uv_run(&loop, UV_RUN_DEFAULT));
+  ASSERT(0 == uv_loop_close(&loop));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+#define HEAP_TIMERS 200
+
+static uv_timer_t heap_timers[HEAP_TIMERS];
+static uint64_t heap_last_timeout;
+static uint64_t heap_last_start_id;
+static int heap_cb_called;
+
+
+static void heap_cb(uv_timer_t* handle) {
+  ASSERT(handle->timeout >= heap_last_timeout);
+  if (handle->timeout == heap_last_timeout)
+    ASSERT(handle->start_id > heap_last_start_id);
+
+  heap_last_timeout = handle->timeout;
+  heap_last_start_id = handle->start_id;
+  heap_cb_called++;
+}
+
+
+TEST_IMPL(timer_heap_order) {
+  uv_loop_t* loop;
+  int i;
+
+  loop = uv_default_loop();
+
+  /* Plenty of equal timeouts, and stopping every third timer takes nodes out
+   * of the middle of the heap.
+   */
+  for (i = 0; i < HEAP_TIMERS; i++) {
+    ASSERT(0 == uv_timer_init(loop, &heap_timers[i]));
+    ASSERT(0 == uv_timer_start(&heap_timers[i], heap_cb, (i * 37) % 50, 0));
+  }
+
+  for (i = 0; i < HEAP_TIMERS; i += 3)
+    ASSERT(0 == uv_timer_stop(&heap_timers[i]));
+
+  /* Restarting moves a timer to the back of its timeout. */
+  ASSERT(0 == uv_timer_start(&heap_timers[1], heap_cb, 0, 0));
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(heap_cb_called == HEAP_TIMERS - (HEAP_TIMERS + 2) / 3);
+
+  for (i = 0; i < HEAP_TIMERS; i++)
+    uv_close((uv_handle_t*) &heap_timers[i], nullptr);
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+static uint64_t slack_cb_now[2];
+static int slack_cb_called;
+
+
+static void slack_cb(uv_timer_t* handle) {
+  slack_cb_now[slack_cb_called++] = uv_now(handle->loop);
+}
+
+
+TEST_IMPL(timer_slack) {
+  uv_timer_t handles[2];
+  uv_loop_t* loop;
+  uint64_t base;
+  uint64_t now;
+
+  loop = uv_default_loop();
+  ASSERT(0 == uv_timer_init(loop, &handles[0]));
+  ASSERT(0 == uv_timer_init(loop, &handles[1]));
+  ASSERT(0 == uv_timer_get_slack(&handles[0]));
+
+  /* |base| is the only multiple of 256 in either window, so that's where both
+   * timers are moved to.
+   */
+  now = uv_now(loop);
+  base = (now + 511) & ~(uint64_t) 255;
+  uv_timer_set_slack(&handles[0], 150);
+  uv_timer_set_slack(&handles[1], 100);
+  ASSERT(150 == uv_timer_get_slack(&handles[0]));
+  ASSERT(0 == uv_timer_start(&handles[0], slack_cb, base - 100 - now, 0));
+  ASSERT(0 == uv_timer_start(&handles[1], slack_cb, base - 50 - now, 0));
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(slack_cb_called == 2);
+  ASSERT(slack_cb_now[0] >= base);
+  ASSERT(slack_cb_now[0] == slack_cb_now[1]);
+
+  uv_close((uv_handle_t*) &handles[0], nullptr);
+  uv_close((uv_handle_t*) &handles[1], nullptr);
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}
+
+
+#define NS_TIMER_TICKS 20
+#define NS_TIMER_REPEAT 200000
+
+static uv_timer_t ns_timer;
+static uv_timer_t ms_timer;
+static uint64_t ns_timer_due;
+static int ns_timer_cb_called;
+
+
+static void ms_timer_cb(uv_timer_t* handle) {
+  /* Nanosecond timers don't hold up millisecond ones, or the other way. */
+  ASSERT(ns_timer_cb_called == NS_TIMER_TICKS);
+  uv_close((uv_handle_t*) handle, nullptr);
+}
+
+
+static void ns_timer_cb(uv_timer_t* handle) {
+  uint64_t now;
+
+  now = uv_hrtime();
+  ASSERT(now >= ns_timer_due);
+  ns_timer_due = handle->timeout;
+
+  if (++ns_timer_cb_called == NS_TIMER_TICKS)
+    uv_close((uv_handle_t*) handle, nullptr);
+}
+
+
+TEST_IMPL(timer_start_ns) {
+  uv_loop_t* loop;
+  uint64_t start;
+
+  loop = uv_default_loop();
+  ASSERT(0 == uv_timer_init(loop, &ns_timer));
+  ASSERT(0 == uv_timer_init(loop, &ms_timer));
+  ASSERT(UV_EINVAL == uv_timer_start_ns(&ns_timer, nullptr, 0, 0));
+
+  /* A millisecond timer becomes a nanosecond one when it's restarted. */
+  ASSERT(0 == uv_timer_start(&ns_timer, ns_timer_cb, 1000, 0));
+  start = uv_hrtime();
+  ASSERT(0 == uv_timer_start_ns(&ns_timer,
+                                ns_timer_cb,
+                                NS_TIMER_REPEAT,
+                                NS_TIMER_REPEAT));
+  ns_timer_due = ns_timer.timeout;
+  ASSERT(NS_TIMER_REPEAT == uv_timer_get_repeat(&ns_timer));
+  ASSERT(0 == uv_timer_start(&ms_timer, ms_timer_cb, 500, 0));
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(ns_timer_cb_called == NS_TIMER_TICKS);
+  ASSERT(uv_hrtime() - start >= NS_TIMER_TICKS * NS_TIMER_REPEAT);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+}